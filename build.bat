@@ -20,36 +20,61 @@ echo [2/6] Compiling Assembly...
 gcc -m32 -c src/boot/boot.S -o src/boot/boot.o
 gcc -m32 -c src/boot/gdt_flush.S -o src/boot/gdt_flush.o
 gcc -m32 -c src/boot/interrupts.S -o src/boot/interrupts.o
+gcc -m32 -c src/boot/context_switch.S -o src/boot/context_switch.o
+gcc -m32 -c src/boot/ap_trampoline.S -o src/boot/ap_trampoline.o
 if %errorlevel% neq 0 exit /b %errorlevel%
 
 REM --- Step 3: Compile Core Kernel ---
 echo [3/6] Compiling Kernel Core...
-gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -c src/kernel/kernel.c -o src/kernel/kernel.o
-gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -c src/kernel/field.c -o src/kernel/field.o
+gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -fno-omit-frame-pointer -c src/kernel/kernel.c -o src/kernel/kernel.o
+gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -fno-omit-frame-pointer -c src/kernel/field.c -o src/kernel/field.o
+gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -fno-omit-frame-pointer -c src/kernel/runqueue.c -o src/kernel/runqueue.o
+gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -fno-omit-frame-pointer -c src/kernel/pmm.c -o src/kernel/pmm.o
+gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -fno-omit-frame-pointer -c src/kernel/slab.c -o src/kernel/slab.o
+gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -fno-omit-frame-pointer -c src/kernel/paging.c -o src/kernel/paging.o
+gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -fno-omit-frame-pointer -c src/kernel/cpu.c -o src/kernel/cpu.o
+gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -fno-omit-frame-pointer -c src/kernel/mem.c -o src/kernel/mem.o
+gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -fno-omit-frame-pointer -c src/kernel/timer.c -o src/kernel/timer.o
+gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -fno-omit-frame-pointer -c src/kernel/input.c -o src/kernel/input.o
+gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -fno-omit-frame-pointer -c src/kernel/keyboard.c -o src/kernel/keyboard.o
 gcc -m32 -c src/kernel/gdt.c -o src/kernel/gdt.o
 gcc -m32 -c src/kernel/idt.c -o src/kernel/idt.o
 gcc -m32 -c src/kernel/pic.c -o src/kernel/pic.o
+gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -fno-omit-frame-pointer -c src/kernel/apic.c -o src/kernel/apic.o
+gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -fno-omit-frame-pointer -c src/kernel/smp.c -o src/kernel/smp.o
+gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -fno-omit-frame-pointer -c src/kernel/serial.c -o src/kernel/serial.o
+gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -fno-omit-frame-pointer -c src/kernel/trace.c -o src/kernel/trace.o
+gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -fno-omit-frame-pointer -c src/kernel/ksyms.c -o src/kernel/ksyms.o
+gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -fno-omit-frame-pointer -c src/kernel/profile.c -o src/kernel/profile.o
 if %errorlevel% neq 0 exit /b %errorlevel%
 
 REM --- Step 4: Compile Graphics & GUI ---
 echo [4/6] Compiling Graphics Engine...
-gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -c src/kernel/graphics.c -o src/kernel/graphics.o
-gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -c src/kernel/universe.c -o src/kernel/universe.o
-gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -c src/kernel/gui.c -o src/kernel/gui.o
+gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -fno-omit-frame-pointer -c src/kernel/graphics.c -o src/kernel/graphics.o
+gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -fno-omit-frame-pointer -c src/kernel/pixel.c -o src/kernel/pixel.o
+gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -fno-omit-frame-pointer -c src/kernel/pixel_sse2.c -o src/kernel/pixel_sse2.o
+gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -fno-omit-frame-pointer -c src/kernel/fixmath.c -o src/kernel/fixmath.o
+gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -fno-omit-frame-pointer -c src/kernel/universe.c -o src/kernel/universe.o
+gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -fno-omit-frame-pointer -c src/kernel/gui.c -o src/kernel/gui.o
+gcc -m32 -std=gnu99 -ffreestanding -O2 -Wall -Wextra -fno-omit-frame-pointer -c src/kernel/hud.c -o src/kernel/hud.o
 if %errorlevel% neq 0 exit /b %errorlevel%
 
 REM --- Step 5: Link ---
 echo [5/6] Linking...
 ld -mi386pe -T linker.ld -o %KERNEL_PE% ^
-    src/boot/boot.o src/boot/gdt_flush.o src/boot/interrupts.o ^
-    src/kernel/kernel.o src/kernel/field.o src/kernel/gdt.o src/kernel/idt.o src/kernel/pic.o ^
-    src/kernel/graphics.o src/kernel/universe.o src/kernel/gui.o
+    src/boot/boot.o src/boot/gdt_flush.o src/boot/interrupts.o src/boot/context_switch.o src/boot/ap_trampoline.o ^
+    src/kernel/kernel.o src/kernel/field.o src/kernel/runqueue.o src/kernel/pmm.o src/kernel/slab.o src/kernel/paging.o src/kernel/cpu.o src/kernel/mem.o src/kernel/timer.o src/kernel/input.o src/kernel/keyboard.o ^
+    src/kernel/gdt.o src/kernel/idt.o src/kernel/pic.o src/kernel/apic.o src/kernel/smp.o src/kernel/serial.o src/kernel/trace.o src/kernel/ksyms.o src/kernel/profile.o ^
+    src/kernel/graphics.o src/kernel/pixel.o src/kernel/pixel_sse2.o src/kernel/fixmath.o src/kernel/universe.o src/kernel/gui.o src/kernel/hud.o
 if %errorlevel% neq 0 exit /b %errorlevel%
 
 REM --- Step 6: Convert to Binary ---
 echo [6/6] Creating Binary...
 objcopy -O binary %KERNEL_PE% %KERNEL_BIN%
 if %errorlevel% neq 0 exit /b %errorlevel%
+REM Function names for the profiler, into the image's reserved .ksyms
+python tools/embed_symbols.py %KERNEL_PE% %KERNEL_BIN%
+if %errorlevel% neq 0 exit /b %errorlevel%
 
 echo ==================================================
 echo [SUCCESS] ParadoxOS Build Complete!
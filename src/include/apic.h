@@ -0,0 +1,46 @@
+#ifndef APIC_H
+#define APIC_H
+
+#include <stdint.h>
+
+/* Local APIC and IOAPIC
+   Found through CPUID and the ACPI MADT. When both are there the 8259s
+   are masked, ISA IRQ 0-15 are routed through the IOAPIC to the boot CPU
+   on vectors 32-47 (after the MADT's source overrides), and interrupts
+   are acknowledged with one MMIO write. Without them everything stays on
+   the 8259 pair. Both register blocks are mapped uncached. */
+#define APIC_TIMER_VECTOR     0x30
+#define APIC_SPURIOUS_VECTOR  0xFF
+#define APIC_CPU_MAX          32
+
+/* After paging_init() and pic_remap() */
+void apic_init(void);
+void apic_init_ap(void);             // The local APIC of an AP, once the boot CPU has one
+uint8_t apic_enabled(void);
+
+void apic_eoi(void);
+void apic_irq_mask(uint8_t irq);     // ISA IRQ number
+void apic_irq_unmask(uint8_t irq);
+
+/* Processors the MADT lists as usable, boot CPU included */
+uint32_t apic_cpu_count(void);
+uint8_t apic_cpu_apic_id(uint32_t index);
+uint8_t apic_id(void);               // Of the calling CPU
+
+/* Interprocessor interrupts: a fixed vector, an NMI (taken even with
+   interrupts off), or the INIT and startup pair that wakes an AP at a
+   page-aligned real-mode address below 1MB */
+void apic_send_ipi(uint8_t apic_id, uint8_t vector);
+void apic_send_nmi(uint8_t apic_id);
+void apic_send_init(uint8_t apic_id);
+void apic_send_startup(uint8_t apic_id, uint32_t address);
+
+/* Local timer, one-shot: either a count of bus clocks (divided by 1) or
+   a TSC value with TSC-deadline mode. Writing 0 stops the count. */
+uint8_t apic_timer_has_deadline(void);
+void apic_timer_setup(uint8_t vector, uint8_t tsc_deadline);
+void apic_timer_arm(uint32_t count);
+void apic_timer_arm_deadline(uint64_t tsc);
+uint32_t apic_timer_current(void);
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef CPU_H
+#define CPU_H
+
+#include <stdint.h>
+
+/* CPUID feature bits: leaf 1 EDX bits 0-31, leaf 1 ECX bits 32-63,
+   leaf 7 EBX bits 64-95 */
+typedef enum {
+    CPU_FEATURE_FPU  = 0,
+    CPU_FEATURE_PSE  = 3,
+    CPU_FEATURE_TSC  = 4,
+    CPU_FEATURE_MSR  = 5,
+    CPU_FEATURE_APIC = 9,
+    CPU_FEATURE_MTRR = 12,
+    CPU_FEATURE_PAT  = 16,
+    CPU_FEATURE_FXSR = 24,
+    CPU_FEATURE_SSE  = 25,
+    CPU_FEATURE_SSE2 = 26,
+    CPU_FEATURE_TSC_DEADLINE = 32 + 24,
+    CPU_FEATURE_ERMS = 64 + 9             // Fast rep movsb/stosb
+} cpu_feature_t;
+
+typedef struct {
+    char vendor[13];
+    uint32_t max_leaf;
+    uint32_t family;
+    uint32_t model;
+    uint32_t features_edx;
+    uint32_t features_ecx;
+    uint32_t features_ext_ebx;
+} cpu_info_t;
+
+static inline void cpuid(uint32_t leaf, uint32_t* a, uint32_t* b, uint32_t* c, uint32_t* d) {
+    asm volatile ("cpuid"
+                  : "=a"(*a), "=b"(*b), "=c"(*c), "=d"(*d)
+                  : "a"(leaf), "c"(0));
+}
+
+/* Time stamp counter; check CPU_FEATURE_TSC first */
+static inline uint64_t rdtsc(void) {
+    uint32_t lo, hi;
+    asm volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+/* Model-specific registers; check CPU_FEATURE_MSR first */
+static inline uint64_t rdmsr(uint32_t msr) {
+    uint32_t lo, hi;
+    asm volatile ("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline void wrmsr(uint32_t msr, uint64_t value) {
+    asm volatile ("wrmsr" : : "c"(msr), "a"((uint32_t)value), "d"((uint32_t)(value >> 32)));
+}
+
+/* Probe the boot CPU once; everything else reads the cached result */
+void cpu_detect(void);
+uint8_t cpu_has(cpu_feature_t feature);
+const cpu_info_t* cpu_get_info(void);
+
+#endif
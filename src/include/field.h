@@ -11,22 +11,89 @@ typedef enum {
     FIELD_STATE_ENTANGLED      /* Blocked/Waiting on other field */
 } field_state_t;
 
-/* Cognitive Field Structure 
-   Represents a unit of computation as an energy field. */
+/* Saved execution context of a switched-out field (or of the observer).
+   Integer registers live on the field's own stack; esp points at them. */
 typedef struct {
-    uint32_t id;
+    uint32_t esp;
+    uint8_t* fpu;          /* 512-byte FXSAVE (or FNSAVE) image, 16-aligned */
+} field_context_t;
+
+#define FIELD_STACK_SIZE       8192   /* Per field, FPU image at the base */
+#define FIELD_TIMESLICE_TICKS  5      /* Timer ticks per unit of energy */
+
+/* Field handles
+   A handle names one incarnation of a slot: the slot index in the low
+   bits and the slot's generation above them. The generation moves on
+   each time the slot is freed, so a handle kept past its field's end
+   fails to look up instead of reaching whatever took the slot. 0 is
+   never a valid handle. */
+typedef uint32_t field_handle_t;
+
+#define FIELD_HANDLE_INDEX_BITS  12
+#define FIELD_MAX                (1u << FIELD_HANDLE_INDEX_BITS)   /* Slots */
+
+/* Cognitive Field Structure
+   Represents a unit of computation as an energy field. */
+typedef struct cognitive_field {
+    field_handle_t id;
     uint32_t energy;       /* Priority/Resource coupling */
+    uint32_t base_energy;  /* Restored when a new epoch starts */
     uint32_t entropy;      /* Curiosity/Uncertainty metric */
     field_state_t state;
     char name[32];
     
-    /* Context/Stack Pointers would go here */
+    field_context_t context;
+    uint8_t* stack;        /* Bound on first dispatch, 0 until then */
+    uint32_t slice_ticks;  /* Ticks run since energy last decayed */
+    uint32_t run_ticks;    /* Ticks run since creation */
     void (*entry_point)(void);
+    volatile uint8_t doomed;   /* Destroyed; reclaimed by the CPU that next schedules it */
+    
+    /* Run queue links */
+    struct runqueue* rq_owner;     /* Queue it waits on, or 0 */
+    struct cognitive_field* rq_next;
+    struct cognitive_field* rq_prev;
+    uint32_t rq_level;
 } cognitive_field_t;
 
-/* Global System Dynamics */
+/* Global System Dynamics
+   Runnable fields wait in an energy-bucketed run queue, most energetic
+   first. Every FIELD_TIMESLICE_TICKS of CPU costs a field one unit of
+   energy; a spent field sits out the rest of the epoch with its base
+   energy restored, and a new epoch starts once no field has energy left,
+   so a weak field is delayed by strong ones but never starved. Each CPU
+   has its own queue; a new field goes to the least busy CPU, and a CPU
+   with nothing queued steals from the others. */
 void init_cognitive_fields(void);
-void field_update_dynamics(void); /* The "Scheduler" */
-void create_excitation(const char* name, void (*function)(void), uint32_t initial_energy);
+void field_update_dynamics(void); /* The "Scheduler": yield to the most energetic field */
+field_handle_t create_excitation(const char* name, void (*function)(void), uint32_t initial_energy);  /* 0 when full */
+
+/* Slots are recycled: a field is reclaimed when its entry point returns
+   or it is destroyed. Lookup returns 0 for stale handles. */
+cognitive_field_t* field_lookup(field_handle_t handle);
+void field_destroy(field_handle_t handle);   /* Does not return when it names the caller */
+uint32_t field_live_count(void);
+
+/* CPU use: a copy of each live field's tick count, for share-of-CPU
+   displays. Fills out with up to max fields and returns how many. */
+typedef struct {
+    field_handle_t id;
+    uint32_t run_ticks;
+    char name[32];
+} field_usage_t;
+
+uint32_t field_usage(field_usage_t* out, uint32_t max);
+
+/* Preemption
+   The GUI loop is the observer context. It lends the CPU to fields while
+   it waits for its next frame and takes it back on the first timer tick
+   past the deadline, however long a field runs. */
+void field_idle_until(uint64_t deadline_ns);   /* Observer only */
+void field_timer_tick(void);                   /* IRQ 0, after EOI */
+
+/* Application processors: set up this CPU's run queues, then schedule on
+   it for good. The boot CPU's are set up by init_cognitive_fields(). */
+void field_cpu_start(void);
+void field_cpu_run(void) __attribute__((noreturn));
 
 #endif
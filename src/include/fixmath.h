@@ -0,0 +1,48 @@
+#ifndef FIXMATH_H
+#define FIXMATH_H
+
+#include <stdint.h>
+
+/* Q16.16 fixed point */
+typedef int32_t fixed_t;
+
+#define FIXED_SHIFT   16
+#define FIXED_ONE     (1 << FIXED_SHIFT)
+#define FIXED_HALF    (FIXED_ONE / 2)
+
+#define FIXED_FROM_INT(i)      ((fixed_t)(i) << FIXED_SHIFT)
+#define FIXED_TO_INT(f)        ((int32_t)(f) >> FIXED_SHIFT)
+#define FIXED_FROM_RATIO(n, d) ((fixed_t)(((int32_t)(n) << FIXED_SHIFT) / (d)))
+#define FIXED_FROM_MS(ms)      FIXED_FROM_RATIO(ms, 1000)
+#define FIXED_FROM_NS(ns)      ((fixed_t)(((uint64_t)(ns) * 281475u) >> 32))  // ns < 2^31
+
+static inline fixed_t fixed_mul(fixed_t a, fixed_t b) {
+    return (fixed_t)(((int64_t)a * b) >> FIXED_SHIFT);
+}
+
+/* Binary angle: the full 32-bit range is one turn, so angles wrap for
+   free and never need range reduction. */
+typedef uint32_t angle_t;
+
+#define ANGLE_QUARTER  0x40000000u
+#define ANGLE_HALF     0x80000000u
+
+/* 2^32 / (2 * pi): angle units per radian */
+#define ANGLE_PER_RADIAN  683565276LL
+
+/* Radians (Q16.16) to a binary angle */
+static inline angle_t fixed_to_angle(fixed_t radians) {
+    return (angle_t)(((int64_t)radians * ANGLE_PER_RADIAN) >> FIXED_SHIFT);
+}
+
+/* Table-driven sine and cosine, Q16.16 results in [-1, 1].
+   The plain versions interpolate between table steps; the _fast versions
+   return the nearest lower step. Both run in constant time. */
+#define FIXED_SINE_STEPS 256
+
+fixed_t fixed_sin(angle_t a);
+fixed_t fixed_cos(angle_t a);
+fixed_t fixed_sin_fast(angle_t a);
+fixed_t fixed_cos_fast(angle_t a);
+
+#endif
@@ -2,6 +2,7 @@
 #define GDT_H
 
 #include <stdint.h>
+#include "smp.h"
 
 struct gdt_entry_struct {
     uint16_t limit_low;           // The lower 16 bits of the limit.
@@ -20,6 +21,16 @@ struct gdt_ptr_struct {
 typedef struct gdt_entry_struct gdt_entry_t;
 typedef struct gdt_ptr_struct gdt_ptr_t;
 
+/* Flat kernel and user segments, then one small data segment per CPU
+   for %gs (see smp.h) */
+#define GDT_CPU_FIRST  5
+#define GDT_CPUS       SMP_CPU_MAX
+#define GDT_ENTRIES    (GDT_CPU_FIRST + GDT_CPUS)
+
 void init_gdt();
+void gdt_load();   // Same table on another CPU
+
+/* Point CPU cpu's segment at [base, base + size); returns its selector */
+uint16_t gdt_set_cpu_segment(uint32_t cpu, uint32_t base, uint32_t size);
 
 #endif
@@ -5,14 +5,32 @@
 
 /* Graphics context */
 typedef struct {
-    uint32_t* framebuffer;
+    uint32_t* framebuffer;   /* Linear framebuffer (video memory) */
+    uint32_t* backbuffer;    /* Draw target, always 32bpp */
     uint32_t width;
     uint32_t height;
-    uint32_t pitch;
+    uint32_t pitch;          /* Framebuffer bytes per row */
+    uint32_t stride;         /* Back buffer pixels per row */
     uint8_t bpp;
     uint8_t initialized;
 } graphics_context_t;
 
+/* Screen rectangle, half-open: [x0, x1) x [y0, y1) */
+typedef struct {
+    uint32_t x0, y0;
+    uint32_t x1, y1;
+} graphics_rect_t;
+
+/* Per-frame damage statistics */
+typedef struct {
+    uint32_t frames;          /* Frames presented since boot */
+    uint32_t pixels_pushed;   /* Pixels copied to video memory by the last present */
+    uint32_t damage_rects;    /* Rectangles the last present walked */
+    uint32_t pixels_cleared;  /* Pixels restored to the background for the last frame */
+    uint32_t commands;        /* Draw commands the last frame recorded */
+    uint32_t tiles;           /* Tile bins rasterised for the last frame */
+} graphics_frame_stats_t;
+
 /* Color type (ARGB) */
 typedef uint32_t color_t;
 
@@ -30,7 +48,44 @@ typedef uint32_t color_t;
 void graphics_init(uint32_t addr, uint32_t width, uint32_t height, uint32_t pitch, uint8_t bpp);
 uint8_t graphics_is_available(void);
 
+/* Deferred rasterisation
+   Drawing on the screen records commands, binned by the
+   GRAPHICS_TILE_SIZE tiles they overlap. A flush rasterises the tiles on
+   every CPU at once, each bin in recording order and clipped to its
+   tile, and returns when all of them are done. Text runs and sprite
+   headers are copied when recorded; sprite spans are not, so they have
+   to stay put until the next flush. A flush only runs on the boot CPU
+   and not inside another one; anywhere else it leaves the list alone. */
+#define GRAPHICS_TILE_SHIFT  6
+#define GRAPHICS_TILE_SIZE   (1 << GRAPHICS_TILE_SHIFT)
+
+void graphics_flush(void);
+
+/* For a crash report, on whatever CPU took the fault: the command list
+   in flight is dropped, and from now on every primitive draws at once
+   and graphics_present() copies the whole back buffer, all on the
+   calling CPU. There is no way back. */
+void graphics_panic(void);
+
+/* Flush, then copy the finished back buffer frame to the framebuffer.
+   Only the damaged region of this frame and the previous one is copied. */
+void graphics_present(void);
+const graphics_frame_stats_t* graphics_get_frame_stats(void);
+
+/* Blending
+   GRAPHICS_BLEND_NONE writes colors as they are (alpha byte ignored).
+   GRAPHICS_BLEND_ALPHA composites colors whose alpha is below 0xFF
+   source-over, with integer math. */
+typedef enum {
+    GRAPHICS_BLEND_NONE,
+    GRAPHICS_BLEND_ALPHA
+} graphics_blend_mode_t;
+
+void graphics_set_blend_mode(graphics_blend_mode_t mode);
+graphics_blend_mode_t graphics_get_blend_mode(void);
+
 /* Drawing primitives */
+/* Repeated clears to the same color only erase the previous frame's damage */
 void graphics_clear(color_t color);
 void graphics_put_pixel(uint32_t x, uint32_t y, color_t color);
 void graphics_draw_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h, color_t color);
@@ -44,8 +99,65 @@ void graphics_draw_char(uint32_t x, uint32_t y, char c, color_t color);
 void graphics_draw_string(uint32_t x, uint32_t y, const char* str, color_t color);
 void graphics_draw_string_centered(uint32_t y, const char* str, color_t color);
 
+/* Text runs: a single line rasterised once and redrawn from its pixel
+   masks. Lines are cut at '\n' or GRAPHICS_TEXT_RUN_MAX characters. */
+#define GRAPHICS_TEXT_RUN_MAX    64
+#define GRAPHICS_TEXT_RUN_WORDS  (GRAPHICS_TEXT_RUN_MAX * 8 / 32)
+
+typedef struct {
+    int32_t x, y;
+    uint32_t length;                                /* Characters */
+    uint32_t rows[8][GRAPHICS_TEXT_RUN_WORDS];      /* Bit i = pixel x + i */
+} graphics_text_run_t;
+
+void graphics_text_run_init(graphics_text_run_t* run, uint32_t x, uint32_t y, const char* str);
+void graphics_text_run_init_centered(graphics_text_run_t* run, uint32_t y, const char* str);
+void graphics_text_run_draw(const graphics_text_run_t* run, color_t color);
+
+/* Off-screen surfaces (32bpp ARGB)
+   While a surface is the target, every primitive draws into it instead of
+   the back buffer. Colors are stored with their alpha byte as given (no
+   blending) and nothing is recorded as damage. Pass NULL to draw on the
+   screen again; graphics_present() does nothing until then. */
+typedef struct {
+    uint32_t* pixels;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;         /* Pixels per row */
+} graphics_surface_t;
+
+void graphics_set_target(const graphics_surface_t* surface);
+
+/* Sprites: a surface run-length encoded into spans of one color.
+   Pixels with alpha 0 are left out. On draw, opaque spans are filled and
+   translucent ones composited source-over, whatever the blend mode. */
+#define GRAPHICS_SPRITE_COLORS  16
+
+typedef struct {
+    int16_t x, y;            /* Offset from the sprite origin */
+    uint16_t length;
+    uint16_t color;          /* Palette index */
+} graphics_span_t;
+
+typedef struct {
+    const graphics_span_t* spans;
+    uint32_t span_count;
+    int32_t x0, y0, x1, y1;  /* Bounds of the spans, half-open */
+    uint32_t color_count;
+    color_t palette[GRAPHICS_SPRITE_COLORS];
+} graphics_sprite_t;
+
+/* Encode surface pixels into spans[] (caller storage), relative to the
+   origin. Returns 0 when it needs more than max_spans spans or more than
+   GRAPHICS_SPRITE_COLORS colors. */
+uint8_t graphics_sprite_encode(graphics_sprite_t* sprite, const graphics_surface_t* surface,
+                               int32_t origin_x, int32_t origin_y,
+                               graphics_span_t* spans, uint32_t max_spans);
+void graphics_sprite_draw(const graphics_sprite_t* sprite, int32_t x, int32_t y);
+
 /* Utility */
 color_t graphics_blend_color(color_t c1, color_t c2, float t);
+color_t graphics_mix_color(color_t c1, color_t c2, uint32_t weight); /* weight 0..256 */
 uint32_t graphics_get_width(void);
 uint32_t graphics_get_height(void);
 
@@ -2,6 +2,8 @@
 #define GUI_H
 
 #include <stdint.h>
+#include "fixmath.h"
+#include "input.h"
 
 /* GUI States (Observer Journey) */
 typedef enum {
@@ -12,11 +14,14 @@ typedef enum {
     GUI_STATE_CAPABILITY      // Capability activation
 } gui_state_t;
 
+/* Frame rate the main loop paces the GUI to */
+#define GUI_TARGET_FPS  60
+
 /* GUI Module */
 void gui_init(void);
-void gui_update(float delta_time);
+void gui_update(fixed_t delta_time);
 void gui_render(void);
-void gui_handle_key(uint8_t scancode);
+void gui_handle_key(const input_event_t* event);  // Main loop only, via gui_update()
 gui_state_t gui_get_state(void);
 void gui_set_state(gui_state_t state);
 
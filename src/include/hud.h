@@ -0,0 +1,27 @@
+#ifndef HUD_H
+#define HUD_H
+
+#include <stdint.h>
+
+/* Desktop overlays
+   The performance HUD sits on the status bar: a live summary in the bar
+   and a panel above its right end with frame-time percentiles, FPS,
+   pixels pushed, IRQ rates per vector, field CPU shares, free memory
+   and a graph of recent frame times. Its text is rasterised again every
+   HUD_REFRESH_FRAMES frames; in between a frame only redraws the panel's
+   own rectangle. Hidden, it records and draws nothing.
+
+   The profiler panel lists the functions with the most samples (see
+   profile.h). Both are drawn by gui_desktop_render(). */
+#define HUD_HISTORY         128      // Frames in the percentiles and graph
+#define HUD_REFRESH_FRAMES  15
+
+void hud_toggle(void);               // F8
+uint8_t hud_visible(void);
+void hud_render(void);               // After the status bar background
+
+void hud_profile_toggle(void);       // F9: sampling with a fresh table, or off
+uint8_t hud_profile_visible(void);
+void hud_profile_render(void);
+
+#endif
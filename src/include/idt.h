@@ -19,7 +19,43 @@ struct idt_ptr_struct {
 typedef struct idt_entry_struct idt_entry_t;
 typedef struct idt_ptr_struct idt_ptr_t;
 
+/* Vectors 0-31 are CPU exceptions, 32-47 the ISA IRQ lines (PIC or
+   IOAPIC), 48-63 local APIC sources; 255 is the APIC spurious vector */
+#define IDT_EXCEPTIONS       32
+#define IDT_IRQ_BASE         32      // Same as PIC_IRQ_BASE
+#define IDT_IRQS             16
+#define IDT_LOCAL_BASE       48      // APIC_TIMER_VECTOR and up
+#define IDT_STUB_VECTORS     64
+#define IDT_SPURIOUS_VECTOR  0xFF
+
+/* Saved by the common stubs, lowest address first */
+typedef struct registers {
+    uint32_t ds;
+    uint32_t edi, esi, ebp, esp, ebx, edx, ecx, eax;   // pusha
+    uint32_t int_no, err_code;
+    uint32_t eip, cs, eflags, useresp, ss;             // Pushed by the CPU
+} registers_t;
+
+typedef void (*interrupt_handler_t)(registers_t* regs);
+
 void init_idt();
+void idt_load(void);   // The same table on an AP
 void idt_set_gate(uint8_t num, uint32_t base, uint16_t sel, uint8_t flags);
 
+/* Dispatch
+   One handler per vector, called with interrupts off. IRQs are
+   acknowledged (APIC EOI, or the 8259s without one) before their handler
+   runs, so a handler may switch stacks. An exception without a handler
+   halts the CPU. */
+void interrupt_register(uint8_t vector, interrupt_handler_t handler);
+void irq_register(uint8_t irq, interrupt_handler_t handler);   // Vector IDT_IRQ_BASE + irq
+void irq_mask(uint8_t irq);
+void irq_unmask(uint8_t irq);
+
+/* Counters since boot, over all CPUs. Spurious interrupts (PIC IRQ 7/15, the APIC
+   spurious vector) are counted apart and never reach a handler. */
+uint32_t interrupt_count(uint8_t vector);
+uint32_t interrupt_spurious_count(void);
+const char* interrupt_exception_name(uint8_t vector);
+
 #endif
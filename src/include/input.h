@@ -0,0 +1,55 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdint.h>
+
+/* Key codes: printable keys use their unshifted ASCII value */
+typedef enum {
+    KEY_NONE        = 0x00,
+    KEY_BACKSPACE   = '\b',
+    KEY_TAB         = '\t',
+    KEY_ENTER       = '\n',
+    KEY_ESCAPE      = 0x1B,
+    KEY_SPACE       = ' ',
+
+    KEY_F1          = 0x80,
+    KEY_F2, KEY_F3, KEY_F4, KEY_F5, KEY_F6,
+    KEY_F7, KEY_F8, KEY_F9, KEY_F10, KEY_F11, KEY_F12,
+
+    KEY_UP, KEY_DOWN, KEY_LEFT, KEY_RIGHT,
+    KEY_HOME, KEY_END, KEY_PAGE_UP, KEY_PAGE_DOWN,
+    KEY_INSERT, KEY_DELETE,
+
+    KEY_LSHIFT, KEY_RSHIFT, KEY_LCTRL, KEY_RCTRL,
+    KEY_LALT, KEY_RALT, KEY_CAPS_LOCK, KEY_NUM_LOCK, KEY_SCROLL_LOCK,
+
+    KEY_UNKNOWN     = 0xFF
+} keycode_t;
+
+/* Modifier state carried by every event */
+#define KEY_MOD_SHIFT  0x01
+#define KEY_MOD_CTRL   0x02
+#define KEY_MOD_ALT    0x04
+#define KEY_MOD_CAPS   0x08   // Caps Lock is on
+
+typedef struct {
+    uint64_t time_ns;         // When IRQ 1 delivered the last byte (timer clock)
+    uint8_t keycode;          // keycode_t
+    uint8_t ascii;            // Character with Shift/Caps applied, 0 if none
+    uint8_t pressed;          // 1 = make, 0 = break
+    uint8_t modifiers;        // KEY_MOD_* after this event
+} input_event_t;
+
+/* Producer side, IRQ 1 only: queue one raw byte with its timestamp */
+void input_push_scancode(uint8_t scancode);
+
+/* Consumer side, main loop only: translate and return the next key
+   event. Returns 0 once the queue is empty. */
+uint8_t input_poll(input_event_t* event);
+uint32_t input_dropped(void);   // Bytes lost to a full queue
+
+/* Keyboard driver (keyboard.c) */
+void keyboard_irq(void);
+uint8_t keyboard_translate(uint8_t scancode, input_event_t* event);
+
+#endif
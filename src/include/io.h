@@ -13,6 +13,7 @@ static inline uint8_t inb(uint16_t port) {
     return ret;
 }
 
+#ifndef PARADOX_HOST
 static inline void sti() {
     asm volatile ("sti");
 }
@@ -21,4 +22,29 @@ static inline void cli() {
     asm volatile ("cli");
 }
 
+/* Disable interrupts and return the previous EFLAGS for irq_restore() */
+static inline uint32_t irq_save(void) {
+    uint32_t flags;
+    asm volatile ("pushfl; popl %0; cli" : "=r"(flags) : : "memory");
+    return flags;
+}
+
+static inline void irq_restore(uint32_t flags) {
+    if (flags & 0x200) sti();  // IF was set
+}
+
+/* Sleep until the next interrupt */
+static inline void hlt() {
+    asm volatile ("hlt");
+}
+#else
+/* Host benchmark build (tools/hostbench): user mode takes no interrupts
+   and may not mask them, so these only order memory */
+static inline void sti() { asm volatile ("" : : : "memory"); }
+static inline void cli() { asm volatile ("" : : : "memory"); }
+static inline uint32_t irq_save(void) { cli(); return 0; }
+static inline void irq_restore(uint32_t flags) { (void)flags; sti(); }
+static inline void hlt() { asm volatile ("pause"); }
+#endif
+
 #endif
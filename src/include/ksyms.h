@@ -0,0 +1,19 @@
+#ifndef KSYMS_H
+#define KSYMS_H
+
+#include <stdint.h>
+
+/* Kernel symbol table
+   Written into the image's .ksyms section after linking by
+   tools/embed_symbols.py: "KSYM", a count, then count entries of
+   { address, name offset } sorted by address, and the names. The last
+   entry has an empty name and marks the end of .text. */
+#define KSYMS_MAGIC  0x4D59534Bu   // "KSYM"
+
+uint8_t ksyms_present(void);
+
+/* Function containing addr, or 0 when it is unknown. *start gets the
+   function's address when it is found. */
+const char* ksyms_lookup(uint32_t addr, uint32_t* start);
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef MEM_H
+#define MEM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Memory copy and fill
+   The C names, so the calls GCC emits by itself (struct copies, zeroed
+   arrays) land here too. Each call picks a path by size:
+     below MEM_SMALL bytes   a few overlapping word moves, no loop
+     below MEM_REP_MIN       a loop of four words per step; rep's
+                             startup costs more than the whole copy here
+     up to MEM_STREAM_MIN    rep movsl / rep stosl from an aligned
+                             destination, bytes for the tail
+     from MEM_STREAM_MIN     SSE2 non-temporal stores (movnti), so a copy
+                             larger than the caches does not evict them
+   memmove() goes from the small path straight to rep, forwards or, for a
+   destination above an overlapping source, backwards.
+   The streaming path is enabled by mem_init() when CPUID reports SSE2
+   and not ERMS, whose rep movs already streams large copies.
+   It stores from integer registers and leaves the FPU/SSE state alone,
+   so every path is safe in interrupt handlers. */
+#define MEM_SMALL       32
+#define MEM_REP_MIN     512
+#define MEM_STREAM_MIN  (256 * 1024)
+
+void mem_init(void);     // After cpu_detect()
+uint8_t mem_streaming(void);
+
+void* memcpy(void* dst, const void* src, size_t n);
+void* memmove(void* dst, const void* src, size_t n);
+void* memset(void* dst, int c, size_t n);
+
+#endif
@@ -3,6 +3,11 @@
 
 #include <stdint.h>
 
+/* multiboot_info_t.flags: which fields are valid */
+#define MULTIBOOT_INFO_MEMORY       (1 << 0)    // mem_lower, mem_upper
+#define MULTIBOOT_INFO_MEM_MAP      (1 << 6)    // mmap_addr, mmap_length
+#define MULTIBOOT_INFO_FRAMEBUFFER  (1 << 12)
+
 /* Multiboot information structure */
 typedef struct {
     uint32_t flags;
@@ -37,4 +42,15 @@ typedef struct {
     uint8_t  color_info[6];
 } __attribute__((packed)) multiboot_info_t;
 
+/* Memory map entry. size excludes the size field itself, so the next
+   entry starts size + 4 bytes further on. */
+typedef struct {
+    uint32_t size;
+    uint64_t addr;
+    uint64_t len;
+    uint32_t type;
+} __attribute__((packed)) multiboot_mmap_entry_t;
+
+#define MULTIBOOT_MEMORY_AVAILABLE  1
+
 #endif
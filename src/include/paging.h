@@ -0,0 +1,46 @@
+#ifndef PAGING_H
+#define PAGING_H
+
+#include <stdint.h>
+#include "multiboot.h"
+
+/* Two-level 32-bit paging
+   RAM is identity mapped write-back, in 4MB pages when the CPU has PSE.
+   The framebuffer is identity mapped write-combining: through the PAT
+   when there is one, otherwise through a variable-range MTRR over a
+   write-back mapping. Allocators keep treating physical addresses as
+   pointers. */
+#define PAGING_PAGE_SIZE   0x1000
+#define PAGING_LARGE_SIZE  0x400000
+
+/* Page table entry bits */
+#define PAGE_PRESENT  0x001
+#define PAGE_WRITE    0x002
+#define PAGE_USER     0x004
+#define PAGE_PWT      0x008
+#define PAGE_PCD      0x010
+#define PAGE_LARGE    0x080   // Directory entry maps 4MB
+#define PAGE_GLOBAL   0x100
+
+typedef enum {
+    PAGING_CACHE_WB,   // Normal RAM
+    PAGING_CACHE_WC,   // Framebuffers: stores are combined into bursts
+    PAGING_CACHE_UC    // Device registers
+} paging_cache_t;
+
+/* Build the identity map and turn paging on. After pmm_init(): page
+   tables come from the page allocator. */
+void paging_init(const multiboot_info_t* mbi);
+void paging_init_ap(void);   // Same tables, PAT and WC MTRR on an AP
+uint8_t paging_enabled(void);
+
+/* Map [virt, virt + size) to phys, kernel read/write, using 4MB pages
+   where both sides are aligned. Addresses are rounded out to pages.
+   Returns 0 when a page table could not be allocated. */
+uint8_t paging_map(uint32_t virt, uint32_t phys, uint32_t size, paging_cache_t cache);
+void paging_unmap(uint32_t virt, uint32_t size);
+
+/* Physical address behind virt. Returns 0 when it is not mapped. */
+uint8_t paging_translate(uint32_t virt, uint32_t* phys);
+
+#endif
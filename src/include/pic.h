@@ -0,0 +1,16 @@
+#ifndef PIC_H
+#define PIC_H
+
+#include <stdint.h>
+
+/* 8259 PIC pair; IRQ 0-7 on the master, 8-15 on the slave */
+#define PIC_IRQ_BASE  0x20   // Vector of IRQ 0 after pic_remap()
+
+void pic_remap(int offset1, int offset2);
+void pic_send_eoi(uint8_t irq);
+void pic_mask(uint8_t irq);
+void pic_unmask(uint8_t irq);
+void pic_disable(void);          // Mask every line, for the APIC to take over
+uint16_t pic_in_service(void);   // ISR of both chips, slave in the high byte
+
+#endif
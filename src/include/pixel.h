@@ -0,0 +1,78 @@
+#ifndef PIXEL_H
+#define PIXEL_H
+
+#include <stdint.h>
+
+/* Pixel span kernels (32bpp ARGB)
+   graphics.c calls through pixel_ops; pixel_init() picks the SSE2 set
+   when the CPU has it and keeps the scalar set otherwise. */
+typedef struct {
+    void (*fill)(uint32_t* dst, uint32_t color, uint32_t count);
+    void (*blit)(uint32_t* dst, const uint32_t* src, uint32_t count);
+    void (*stream)(uint32_t* dst, const uint32_t* src, uint32_t count);  /* Write-once targets (VRAM) */
+    void (*blend)(uint32_t* dst, const uint32_t* src, uint32_t count);   /* Source-over, src alpha */
+    void (*blend_solid)(uint32_t* dst, uint32_t color, uint32_t count); /* Source-over, one color */
+} pixel_ops_t;
+
+extern pixel_ops_t pixel_ops;
+
+void pixel_init(void);
+uint8_t pixel_simd_enabled(void);
+
+/* Scalar kernels */
+void pixel_fill_scalar(uint32_t* dst, uint32_t color, uint32_t count);
+void pixel_blit_scalar(uint32_t* dst, const uint32_t* src, uint32_t count);
+void pixel_blend_scalar(uint32_t* dst, const uint32_t* src, uint32_t count);
+void pixel_blend_solid_scalar(uint32_t* dst, uint32_t color, uint32_t count);
+
+/* SSE2 kernels (pixel_sse2.c) */
+void pixel_fill_sse2(uint32_t* dst, uint32_t color, uint32_t count);
+void pixel_blit_sse2(uint32_t* dst, const uint32_t* src, uint32_t count);
+void pixel_stream_sse2(uint32_t* dst, const uint32_t* src, uint32_t count);
+void pixel_blend_sse2(uint32_t* dst, const uint32_t* src, uint32_t count);
+void pixel_blend_solid_sse2(uint32_t* dst, uint32_t color, uint32_t count);
+
+/* Exact x / 255 for x <= 255 * 255, rounded to nearest */
+static inline uint32_t pixel_div255(uint32_t x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+/* Two 16-bit lanes of x / 255 at once, each rounded like pixel_div255 */
+static inline uint32_t pixel_div255_x2(uint32_t x) {
+    x += 0x00800080;
+    return ((x + ((x >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+}
+
+/* A color multiplied by its own alpha, two channels per word, so blending
+   it costs two multiplies per pixel. The source alpha channel counts as
+   fully covered: A' = As + Ad(1 - As). */
+typedef struct {
+    uint32_t ag;             /* 255 * A << 16 | G * A */
+    uint32_t rb;             /* R * A << 16 | B * A */
+    uint32_t inv_alpha;      /* 255 - A */
+} pixel_premul_t;
+
+static inline pixel_premul_t pixel_premultiply(uint32_t color) {
+    uint32_t a = color >> 24;
+    pixel_premul_t p;
+    
+    p.ag = (((color | 0xFF000000) >> 8) & 0x00FF00FF) * a;
+    p.rb = (color & 0x00FF00FF) * a;
+    p.inv_alpha = 255 - a;
+    return p;
+}
+
+static inline uint32_t pixel_blend_premul(uint32_t dst, pixel_premul_t src) {
+    uint32_t rb = pixel_div255_x2(src.rb + (dst & 0x00FF00FF) * src.inv_alpha);
+    uint32_t ag = pixel_div255_x2(src.ag + ((dst >> 8) & 0x00FF00FF) * src.inv_alpha);
+    return (ag << 8) | rb;
+}
+
+/* Source-over of one ARGB color onto one pixel, integer only.
+   The result matches the blend kernels bit for bit. */
+static inline uint32_t pixel_blend_one(uint32_t dst, uint32_t color) {
+    return pixel_blend_premul(dst, pixel_premultiply(color));
+}
+
+#endif
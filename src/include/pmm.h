@@ -0,0 +1,30 @@
+#ifndef PMM_H
+#define PMM_H
+
+#include <stdint.h>
+#include "multiboot.h"
+
+/* Physical page-frame allocator
+   A binary buddy allocator over the RAM the multiboot memory map reports
+   below 4GB. The first megabyte, the kernel image (up to _end), the
+   framebuffer and the boot information stay reserved. Memory is identity
+   mapped, so a physical address is also the pointer to use. */
+#define PMM_PAGE_SIZE   4096
+#define PMM_PAGE_SHIFT  12
+#define PMM_MAX_ORDER   12      // Largest block: 2^12 pages (16MB)
+
+/* Build the free lists. Without a usable memory map every allocation
+   fails and callers fall back to what they had before. */
+void pmm_init(const multiboot_info_t* mbi);
+
+/* count contiguous pages, aligned to the power of two that holds them.
+   Returns the physical address, or 0 when nothing fits. Pages are not
+   cleared. */
+uint32_t pmm_alloc_pages(uint32_t count);
+void pmm_free_pages(uint32_t addr, uint32_t count);   // Same count as allocated
+
+uint32_t pmm_total_pages(void);   // Usable RAM the allocator manages
+uint32_t pmm_top_frame(void);     // One past the highest frame of usable RAM
+uint32_t pmm_free_page_count(void);
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+
+/* Sampling profiler
+   The CMOS RTC's periodic interrupt (IRQ 8) samples the boot CPU: the
+   interrupted EIP and the frame-pointer chain above it go into a table
+   of distinct stacks, each with a sample count. The kernel is built
+   with -fno-omit-frame-pointer; a chain ends at the first frame that
+   leaves RAM, does not move up the stack or jumps more than 64KB.
+   Idle time shows up as samples in the halt. The other CPUs are not
+   sampled.
+
+   Symbols come from the table tools/embed_symbols.py writes into the
+   image after linking (see ksyms.h); without it addresses are reported
+   raw. */
+#define PROFILE_IRQ       8
+#define PROFILE_RTC_RATE  4          // 32768 >> (rate - 1) Hz
+#define PROFILE_HZ        (32768 >> (PROFILE_RTC_RATE - 1))
+#define PROFILE_DEPTH     8          // Frames kept per sample, EIP included
+#define PROFILE_STACKS    1024       // Distinct stacks; power of two
+
+void profile_init(void);             // After apic_init(); sampling starts stopped
+void profile_start(void);
+void profile_stop(void);
+uint8_t profile_running(void);
+void profile_reset(void);            // Clear the table; main loop only
+
+uint32_t profile_sample_count(void);
+uint32_t profile_lost_count(void);   // Samples whose stack found no slot
+
+/* Functions with the most samples at the top of the stack (self time),
+   most first. name is 0 when addr has no symbol. Returns the count
+   written. Safe against sampling: slots are published whole. */
+typedef struct {
+    const char* name;
+    uint32_t addr;                   // Function start, or the raw EIP
+    uint32_t samples;
+} profile_entry_t;
+
+uint32_t profile_top(profile_entry_t* out, uint32_t max);
+
+/* Folded stacks for flamegraph tools, one per line, root first:
+       # PXPROF BEGIN hz=4096 samples=N lost=N
+       kernel_main;gui_render;graphics_present 120
+       # PXPROF END
+   Sent over COM1 in place of the current serial source, which resumes
+   when the dump is done. Sampling pauses meanwhile. Returns 0 without a
+   UART or while a dump is still going out. */
+uint8_t profile_dump(void);
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef RUNQUEUE_H
+#define RUNQUEUE_H
+
+#include <stdint.h>
+#include "field.h"
+
+/* Energy-bucketed run queue
+   One FIFO per energy level and a bitmap of the non-empty ones, so push,
+   remove and pop-highest are constant time however many fields wait.
+   Energies at or above the top level share it. */
+#define RUNQUEUE_LEVELS  64
+#define RUNQUEUE_WORDS   (RUNQUEUE_LEVELS / 32)
+
+typedef struct runqueue {
+    uint32_t bitmap[RUNQUEUE_WORDS];       // Bit n set: level n is non-empty
+    cognitive_field_t* head[RUNQUEUE_LEVELS];
+    cognitive_field_t* tail[RUNQUEUE_LEVELS];
+    uint32_t count;
+} runqueue_t;
+
+void runqueue_init(runqueue_t* rq);
+void runqueue_push(runqueue_t* rq, cognitive_field_t* field);     // Tail of its level
+void runqueue_remove(runqueue_t* rq, cognitive_field_t* field);   // Must be queued on rq
+cognitive_field_t* runqueue_pop(runqueue_t* rq);                  // Head of the highest level, or 0
+
+static inline uint32_t runqueue_level(uint32_t energy) {
+    return energy < RUNQUEUE_LEVELS ? energy : RUNQUEUE_LEVELS - 1;
+}
+
+#endif
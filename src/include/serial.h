@@ -0,0 +1,32 @@
+#ifndef SERIAL_H
+#define SERIAL_H
+
+#include <stdint.h>
+
+/* COM1, 115200 baud 8N1, transmit only
+   Bytes go out of a ring from the transmitter-empty interrupt (IRQ 4),
+   16 at a time through the FIFO. When the ring runs low the interrupt
+   asks the source for more, so a steady producer never waits on the
+   main loop. */
+#define SERIAL_COM1_IRQ  4
+
+void serial_init(void);          // After init_idt() and apic_init(); no-op without a UART
+uint8_t serial_present(void);
+
+/* Boot CPU only, like IRQ 4. Queue what fits and return the bytes
+   taken; never waits. */
+uint32_t serial_write(const void* data, uint32_t len);
+
+/* Source of bytes for an idle or draining ring: fills buf with at most
+   SERIAL_REFILL bytes and returns how many. Called with interrupts off.
+   Returns the source it replaces, so a one-off stream can hand back. */
+#define SERIAL_REFILL  256
+
+typedef uint32_t (*serial_source_t)(uint8_t* buf, uint32_t max);
+
+serial_source_t serial_set_source(serial_source_t source);
+
+/* Top up from the source and start the transmitter if it is idle */
+void serial_pump(void);
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stdint.h>
+
+/* Object caches
+   Each cache hands out objects of one size from slabs: power-of-two page
+   blocks from the page allocator, aligned to their size so an object
+   finds its slab by masking its address. Allocation and free are O(1)
+   while a slab has room; one empty slab per cache is kept back so churn
+   around a boundary does not hit the page allocator.
+
+   A constructor runs once per object when its slab is built, not on
+   every allocation; objects must be freed in their constructed state. */
+typedef struct kmem_cache kmem_cache_t;
+
+typedef struct {
+    const char* name;
+    uint32_t object_size;
+    uint32_t objects_per_slab;
+    uint32_t slabs;              // Held, empty ones included
+    uint32_t pages;
+    uint32_t objects_in_use;
+    uint32_t allocs, frees;      // Since the cache was created
+} kmem_cache_stats_t;
+
+void slab_init(void);            // After pmm_init()
+
+kmem_cache_t* kmem_cache_create(const char* name, uint32_t size, uint32_t align,
+                                void (*ctor)(void* object));
+void* kmem_cache_alloc(kmem_cache_t* cache);     // 0 when out of memory
+void kmem_cache_free(kmem_cache_t* cache, void* object);
+
+void kmem_cache_stats(const kmem_cache_t* cache, kmem_cache_stats_t* stats);
+const kmem_cache_t* kmem_cache_next(const kmem_cache_t* cache);   // 0 gives the first
+
+/* General heap: power-of-two size classes from 16 to 2048 bytes, each a
+   cache. Larger requests take whole pages. Memory is 16-byte aligned and
+   not cleared. */
+#define KMALLOC_MIN_SHIFT  4
+#define KMALLOC_MAX_SHIFT  11
+
+void* kmalloc(uint32_t size);
+void kfree(void* ptr);
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef SMP_H
+#define SMP_H
+
+#include <stdint.h>
+#include "apic.h"
+
+/* Symmetric multiprocessing
+   The boot CPU (index 0) runs the GUI; application processors are woken
+   with INIT-SIPI-SIPI through a real-mode trampoline and spend their
+   lives running fields. Every CPU finds its own cpu_t through %gs, which
+   holds a per-CPU data segment and is never reloaded by interrupts. APs
+   are only started with the local APIC timer, since it is what preempts
+   fields on them. */
+#define SMP_CPU_MAX      APIC_CPU_MAX
+#define SMP_WAKE_VECTOR  (APIC_TIMER_VECTOR + 1)   // No handler: it only ends a hlt
+#define SMP_CALL_VECTOR  (APIC_TIMER_VECTOR + 2)   // smp_call()
+
+typedef struct cpu {
+    struct cpu* self;            // %gs:0
+    uint32_t index;              // %gs:4, 0 on the boot CPU
+    uint8_t apic_id;
+    volatile uint8_t online;
+    uint32_t stack;              // Boot and idle stack of an AP
+} cpu_t;
+
+void smp_init(void);             // Boot CPU's per-CPU segment; after init_gdt()
+void smp_start(void);            // Wake the APs; after timer_init() and init_cognitive_fields()
+uint32_t smp_cpu_count(void);    // CPUs online
+void smp_wake(uint32_t index);   // Interrupt a CPU out of hlt
+
+/* Run fn(arg) on every online CPU at once and return when all are done:
+   here in line, elsewhere from an IPI with interrupts off and the
+   interrupted FPU state kept around it. Boot CPU only, one call at a time:
+   from an AP or inside another call it runs nothing and returns 0. */
+uint8_t smp_call(void (*fn)(void* arg), void* arg);
+
+/* Crash path: NMI every other online CPU, whatever it is doing. Their
+   NMI handler must not return. */
+void smp_stop_others(void);
+
+/* Both move under a field that migrates: read them with interrupts off */
+static inline uint32_t smp_cpu_index(void) {
+    uint32_t index;
+    asm volatile ("movl %%gs:4, %0" : "=r"(index));
+    return index;
+}
+
+static inline cpu_t* smp_this_cpu(void) {
+    cpu_t* cpu;
+    asm volatile ("movl %%gs:0, %0" : "=r"(cpu));
+    return cpu;
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include <stdint.h>
+#include "io.h"
+
+/* Test-and-test-and-set spinlock. Taking one with interrupts on invites
+   an interrupt handler to spin on it forever, so code that handlers can
+   also reach uses the irqsave pair. */
+typedef struct {
+    volatile uint32_t locked;
+} spinlock_t;
+
+#define SPINLOCK_INIT  { 0 }
+
+static inline void spin_lock(spinlock_t* lock) {
+    while (__sync_lock_test_and_set(&lock->locked, 1)) {
+        while (lock->locked) asm volatile ("pause");
+    }
+}
+
+/* 1 when the lock was taken; never waits */
+static inline uint8_t spin_trylock(spinlock_t* lock) {
+    return !lock->locked && !__sync_lock_test_and_set(&lock->locked, 1);
+}
+
+static inline void spin_unlock(spinlock_t* lock) {
+    __sync_lock_release(&lock->locked);
+}
+
+static inline uint32_t spin_lock_irqsave(spinlock_t* lock) {
+    uint32_t flags = irq_save();
+    spin_lock(lock);
+    return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t* lock, uint32_t flags) {
+    spin_unlock(lock);
+    irq_restore(flags);
+}
+
+#endif
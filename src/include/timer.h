@@ -0,0 +1,56 @@
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+#include "fixmath.h"
+
+/* Ticks come from the local APIC timer in one-shot (or TSC-deadline)
+   mode when there is an APIC and a TSC, otherwise from PIT channel 0 on
+   IRQ 0 */
+#define PIT_FREQUENCY  1193182   // Input clock, Hz
+#define TIMER_HZ       1000      // Default tick rate
+
+/* Calibrate the TSC (and APIC timer) against the PIT and start ticking.
+   After apic_init(). */
+void timer_init(uint32_t hz);
+void timer_init_ap(void);        // Start ticking on an AP (APIC timer only)
+uint8_t timer_vector(void);      // Where timer_tick() has to be hooked
+void timer_tick(void);           // Tick interrupt handler
+
+/* Halt until an interrupt; call with interrupts off, returns with them
+   on. With the APIC timer the ticks up to wake_ns are skipped, so an idle
+   CPU wakes once instead of every tick. */
+void timer_halt(uint64_t wake_ns);
+
+/* Monotonic clock, counted from timer_init(). Ticks advance at the tick
+   rate (catching up after an idle sleep); nanoseconds come from the TSC
+   when the CPU has one and are tick-granular otherwise. */
+uint64_t timer_ticks(void);
+uint64_t timer_now_ns(void);
+uint32_t timer_tsc_khz(void);    // 0 when there is no usable TSC
+
+/* Frame pacing
+   The loop calls timer_frame_begin() for the real delta, draws, and then
+   timer_frame_end() hands the wait to the idle handler until the next
+   frame is due. A late frame starts the next one at once instead of
+   trying to catch up. */
+typedef struct {
+    uint32_t frames;
+    uint32_t late_frames;        // Frames that overran their slot
+    uint32_t target_ns;          // Frame period asked for
+    uint32_t last_ns;            // Begin-to-begin time of the last frame
+    uint32_t min_ns, max_ns;     // Both capped at TIMER_FRAME_MAX_DELTA_MS
+    uint32_t avg_ns;             // Running average, 1/16 weight per frame
+    uint32_t work_ns;            // Update and render time of the last frame
+    uint32_t idle_ns;            // Halted time after the last frame
+} timer_frame_stats_t;
+
+#define TIMER_FRAME_MAX_DELTA_MS  100   // Longer stalls are not replayed
+
+void timer_frame_init(uint32_t fps);
+void timer_set_idle_handler(void (*idle)(uint64_t deadline_ns));  /* Default: hlt */
+fixed_t timer_frame_begin(void);
+void timer_frame_end(void);
+const timer_frame_stats_t* timer_get_frame_stats(void);
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include "cpu.h"
+#include "smp.h"
+
+/* Trace points
+   Each event is a TSC timestamp, a point, a kind and one argument,
+   written into a ring owned by the CPU that records it. Recording
+   takes no lock: a slot is claimed with a cmpxchg that only has to be
+   atomic against interrupts on the same CPU, and is published by
+   writing its kind last. trace_read() drains every ring into the
+   serial stream format; an event that finds its ring full is counted
+   and dropped.
+
+   Record only with interrupts off or from a context that never
+   migrates (the GUI loop), so the ring stays the current CPU's. A
+   timer IRQ that preempts a field closes when that field next runs. */
+typedef enum {
+    TRACE_GUI_UPDATE,
+    TRACE_GUI_RENDER,
+    TRACE_UNIVERSE_RENDER,       // arg: the universe
+    TRACE_IRQ,                   // arg: vector
+    TRACE_FIELD_PICK,            // arg: field handle, 0 for idle
+    TRACE_PIXELS_PUSHED,         // Counter, per present
+    TRACE_POINTS
+} trace_point_t;
+
+#define TRACE_BEGIN    'B'
+#define TRACE_END      'E'
+#define TRACE_COUNTER  'C'
+#define TRACE_INSTANT  'i'
+#define TRACE_DROPPED  'D'       // Stream only; arg: events lost on that CPU
+
+/* One event, as stored and as sent: 16 bytes, little endian */
+typedef struct {
+    volatile uint8_t kind;       // 0 while free or being written
+    uint8_t cpu;
+    uint16_t point;
+    uint32_t arg;
+    uint64_t tsc;
+} trace_event_t;
+
+#define TRACE_RING_SHIFT  9
+#define TRACE_RING_SIZE   (1u << TRACE_RING_SHIFT)
+
+typedef struct {
+    volatile uint32_t head;      // Next slot to claim; owning CPU only
+    volatile uint32_t tail;      // Next slot to drain; trace_read() only
+    volatile uint32_t dropped;   // Owning CPU only
+    uint32_t dropped_sent;       // trace_read() only
+    trace_event_t events[TRACE_RING_SIZE];
+} trace_ring_t;
+
+extern trace_ring_t* trace_rings;      // SMP_CPU_MAX of them
+extern volatile uint8_t trace_enabled;
+
+void trace_init(void);                 // Needs a TSC; tracing starts enabled
+void trace_enable(uint8_t on);
+
+/* Serial stream
+   A header, then records. The header is "PXTR", a version byte, the
+   point count byte, the TSC rate in kHz (u32) and each point's name as
+   a length byte and characters. It is sent first and again every
+   TRACE_SYNC_EVENTS events, so a capture started late can sync on it.
+   Records are trace_event_t. Fills buf with whole records and returns
+   the bytes written. */
+#define TRACE_MAGIC        0x52545850u   // "PXTR"
+#define TRACE_VERSION      1
+#define TRACE_SYNC_EVENTS  4096
+
+uint32_t trace_read(uint8_t* buf, uint32_t max);
+
+/* Claim head for this CPU's ring; fails if an interrupt got there first */
+static inline uint8_t trace_claim(volatile uint32_t* head, uint32_t expected) {
+    uint8_t ok;
+    asm volatile ("cmpxchgl %3, %1; sete %0"
+                  : "=q"(ok), "+m"(*head), "+a"(expected)
+                  : "r"(expected + 1)
+                  : "memory", "cc");
+    return ok;
+}
+
+static inline void trace_event(uint8_t kind, trace_point_t point, uint32_t arg) {
+    if (!trace_enabled) return;
+    
+    uint32_t cpu = smp_cpu_index();
+    trace_ring_t* ring = &trace_rings[cpu];
+    uint32_t head;
+    do {
+        head = ring->head;
+        if (head - ring->tail >= TRACE_RING_SIZE) {
+            asm volatile ("incl %0" : "+m"(ring->dropped));
+            return;
+        }
+    } while (!trace_claim(&ring->head, head));
+    
+    trace_event_t* event = &ring->events[head & (TRACE_RING_SIZE - 1)];
+    event->tsc = rdtsc();
+    event->arg = arg;
+    event->point = point;
+    event->cpu = cpu;
+    asm volatile ("" : : : "memory");   // Stores stay in order on x86
+    event->kind = kind;
+}
+
+static inline void trace_begin(trace_point_t point, uint32_t arg) {
+    trace_event(TRACE_BEGIN, point, arg);
+}
+
+static inline void trace_end(trace_point_t point, uint32_t arg) {
+    trace_event(TRACE_END, point, arg);
+}
+
+static inline void trace_counter(trace_point_t point, uint32_t value) {
+    trace_event(TRACE_COUNTER, point, value);
+}
+
+static inline void trace_instant(trace_point_t point, uint32_t arg) {
+    trace_event(TRACE_INSTANT, point, arg);
+}
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include "graphics.h"
+#include "fixmath.h"
 
 /* Universe state */
 typedef enum {
@@ -14,27 +15,37 @@ typedef enum {
 
 /* Universe structure (Anchor Universe = Desktop) */
 typedef struct {
-    float x, y;              // Center position
-    float radius;            // Base radius
-    float energy;            // Pulsing energy
-    float formation;         // Formation progress (0.0 - 1.0)
+    fixed_t x, y;            // Center position
+    fixed_t radius;          // Base radius
+    angle_t energy;          // Pulsing energy, as a phase that wraps each cycle
+    fixed_t formation;       // Formation progress (0 - FIXED_ONE)
     universe_state_t state;
     color_t primary_color;
     color_t energy_color;
+    struct universe_sprites* sprites;  // Cached pulse frames, NULL until first drawn
 } universe_t;
 
-/*Simple sine approximation for pulsing */
-float universe_sin(float x);
-float universe_cos(float x);
-
 /* Universe management */
-void universe_init(universe_t* u, float x, float y, float radius, color_t color);
-void universe_update(universe_t* u, float delta_time);
+void universe_init(universe_t* u, fixed_t x, fixed_t y, fixed_t radius, color_t color);
+void universe_update(universe_t* u, fixed_t delta_time);
 void universe_render(universe_t* u);
+void universe_set_colors(universe_t* u, color_t primary, color_t energy);
+
+/* Sprite cache
+   A pulsing, fully formed universe is drawn from UNIVERSE_SPRITE_STEPS
+   pre-rendered frames per pulse cycle. Frames are shared by every universe
+   with the same pixel radius and colors and are built on first use. */
+#define UNIVERSE_SPRITE_STEP_BITS  5
+#define UNIVERSE_SPRITE_STEPS      (1 << UNIVERSE_SPRITE_STEP_BITS)
+#define UNIVERSE_SPRITE_SLOTS      4        // Distinct radius/color keys
+#define UNIVERSE_SPRITE_SPANS      131072   // Span pool shared by all slots (1MB)
+#define UNIVERSE_SPRITE_MAX        320      // Scratch surface edge, pixels
+
+void universe_sprite_flush(void);
 
 /* Anchor Universe (Desktop) */
 void anchor_universe_init(void);
-void anchor_universe_update(float delta_time);
+void anchor_universe_update(fixed_t delta_time);
 void anchor_universe_render(void);
 universe_t* anchor_universe_get(void);
 
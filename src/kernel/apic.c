@@ -0,0 +1,368 @@
+#include "../include/apic.h"
+#include "../include/cpu.h"
+#include "../include/io.h"
+#include "../include/paging.h"
+#include "../include/pic.h"
+
+#define MSR_APIC_BASE      0x01B
+#define MSR_TSC_DEADLINE   0x6E0
+#define APIC_BASE_ENABLE   0x800
+
+/* Local APIC registers, byte offsets */
+#define LAPIC_ID           0x020
+#define LAPIC_TPR          0x080
+#define LAPIC_EOI          0x0B0
+#define LAPIC_SVR          0x0F0
+#define LAPIC_ICR_LOW      0x300
+#define LAPIC_ICR_HIGH     0x310
+#define LAPIC_LVT_TIMER    0x320
+#define LAPIC_LVT_LINT0    0x350
+#define LAPIC_LVT_ERROR    0x370
+#define LAPIC_TIMER_INIT   0x380
+#define LAPIC_TIMER_COUNT  0x390
+#define LAPIC_TIMER_DIV    0x3E0
+
+#define LAPIC_SVR_ENABLE       0x100
+#define LAPIC_LVT_MASKED       0x10000
+#define LAPIC_TIMER_ONESHOT    0x00000
+#define LAPIC_TIMER_DEADLINE   0x40000
+#define LAPIC_TIMER_DIVIDE_1   0x0B
+
+#define ICR_NMI            0x00400
+#define ICR_INIT           0x00500
+#define ICR_STARTUP        0x00600
+#define ICR_PENDING        0x01000
+#define ICR_ASSERT         0x04000
+
+/* IOAPIC: a select register and a window onto the selected one */
+#define IOAPIC_VERSION     0x01
+#define IOAPIC_REDIRECT    0x10   // Two registers per entry
+#define IOAPIC_MAX         4
+
+#define REDIRECT_LOW_ACTIVE  0x2000
+#define REDIRECT_LEVEL       0x8000
+#define REDIRECT_MASKED      0x10000
+
+/* MADT entries and interrupt source override flags */
+#define MADT_LAPIC           0
+#define MADT_IOAPIC          1
+#define MADT_OVERRIDE        2
+#define MADT_LAPIC_ADDRESS   5
+#define MADT_POLARITY_LOW    0x3
+#define MADT_TRIGGER_LEVEL   0xC
+
+#define ISA_IRQS  16
+
+typedef struct {
+    char signature[8];
+    uint8_t checksum;
+    char oem[6];
+    uint8_t revision;
+    uint32_t rsdt;
+} __attribute__((packed)) acpi_rsdp_t;
+
+typedef struct {
+    char signature[4];
+    uint32_t length;
+    uint8_t revision;
+    uint8_t checksum;
+    char oem[6];
+    char oem_table[8];
+    uint32_t oem_revision;
+    uint32_t creator;
+    uint32_t creator_revision;
+} __attribute__((packed)) acpi_header_t;
+
+typedef struct {
+    acpi_header_t header;
+    uint32_t lapic_address;
+    uint32_t flags;
+} __attribute__((packed)) acpi_madt_t;
+
+typedef struct {
+    volatile uint32_t* regs;
+    uint32_t gsi_base;
+    uint32_t gsi_count;
+} ioapic_t;
+
+static volatile uint32_t* lapic = 0;
+static uint8_t enabled = 0;
+
+static ioapic_t ioapics[IOAPIC_MAX];
+static uint32_t ioapic_count = 0;
+
+static uint8_t cpu_ids[APIC_CPU_MAX];
+static uint32_t cpu_count = 0;
+
+/* ISA IRQ to global system interrupt, with redirection polarity/trigger */
+static uint32_t isa_gsi[ISA_IRQS];
+static uint32_t isa_bits[ISA_IRQS];
+
+static inline uint32_t lapic_read(uint32_t reg) {
+    return lapic[reg >> 2];
+}
+
+static inline void lapic_write(uint32_t reg, uint32_t value) {
+    lapic[reg >> 2] = value;
+}
+
+static uint32_t ioapic_read(const ioapic_t* io, uint32_t reg) {
+    io->regs[0] = reg;
+    return io->regs[4];
+}
+
+static void ioapic_write(const ioapic_t* io, uint32_t reg, uint32_t value) {
+    io->regs[0] = reg;
+    io->regs[4] = value;
+}
+
+/* Firmware tables may sit past the RAM the identity map covers */
+static uint8_t map_physical(uint32_t addr, uint32_t size, paging_cache_t cache) {
+    uint32_t phys;
+    if (cache == PAGING_CACHE_WB && paging_translate(addr, &phys) &&
+        paging_translate(addr + size - 1, &phys)) return 1;
+    return paging_map(addr, addr, size, cache);
+}
+
+static uint8_t checksum_ok(const void* data, uint32_t length) {
+    const uint8_t* bytes = data;
+    uint8_t sum = 0;
+    for (uint32_t i = 0; i < length; i++) sum += bytes[i];
+    return sum == 0;
+}
+
+static const acpi_rsdp_t* rsdp_scan(uint32_t start, uint32_t length) {
+    for (uint32_t at = start; at < start + length; at += 16) {
+        const char* s = (const char*)at;
+        if (s[0] == 'R' && s[1] == 'S' && s[2] == 'D' && s[3] == ' ' &&
+            s[4] == 'P' && s[5] == 'T' && s[6] == 'R' && s[7] == ' ' &&
+            checksum_ok(s, sizeof(acpi_rsdp_t))) return (const acpi_rsdp_t*)at;
+    }
+    return 0;
+}
+
+/* The RSDP is in the first KB of the EBDA or in the BIOS area. The EBDA
+   segment is read with asm: GCC takes a pointer this low for null. */
+static const acpi_rsdp_t* rsdp_find(void) {
+    uint16_t segment;
+    asm volatile ("movw 0x40E, %0" : "=r"(segment));
+    uint32_t ebda = (uint32_t)segment << 4;
+    const acpi_rsdp_t* rsdp = 0;
+    if (ebda >= 0x80000 && ebda < 0xA0000) rsdp = rsdp_scan(ebda, 1024);
+    return rsdp ? rsdp : rsdp_scan(0xE0000, 0x20000);
+}
+
+static const acpi_madt_t* madt_find(void) {
+    const acpi_rsdp_t* rsdp = rsdp_find();
+    if (!rsdp || !map_physical(rsdp->rsdt, sizeof(acpi_header_t), PAGING_CACHE_WB)) return 0;
+    
+    const acpi_header_t* rsdt = (const acpi_header_t*)rsdp->rsdt;
+    if (!map_physical(rsdp->rsdt, rsdt->length, PAGING_CACHE_WB) || !checksum_ok(rsdt, rsdt->length)) return 0;
+    
+    const uint32_t* entries = (const uint32_t*)(rsdt + 1);
+    uint32_t count = (rsdt->length - sizeof(acpi_header_t)) / 4;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!map_physical(entries[i], sizeof(acpi_header_t), PAGING_CACHE_WB)) continue;
+        
+        const acpi_header_t* table = (const acpi_header_t*)entries[i];
+        if (table->signature[0] != 'A' || table->signature[1] != 'P' ||
+            table->signature[2] != 'I' || table->signature[3] != 'C') continue;
+        if (map_physical(entries[i], table->length, PAGING_CACHE_WB) && checksum_ok(table, table->length)) {
+            return (const acpi_madt_t*)table;
+        }
+    }
+    return 0;
+}
+
+/* Processors, IOAPICs and ISA overrides; 0 when there is no IOAPIC */
+static uint8_t madt_parse(uint32_t* lapic_address) {
+    const acpi_madt_t* madt = madt_find();
+    if (!madt) return 0;
+    
+    *lapic_address = madt->lapic_address;
+    for (int i = 0; i < ISA_IRQS; i++) {
+        isa_gsi[i] = i;
+        isa_bits[i] = 0;   // ISA: edge, active high
+    }
+    
+    const uint8_t* at = (const uint8_t*)(madt + 1);
+    const uint8_t* stop = (const uint8_t*)madt + madt->header.length;
+    while (at + 2 <= stop && at[1] >= 2 && at + at[1] <= stop) {
+        switch (at[0]) {
+            case MADT_LAPIC:
+                // Enabled, processor id, APIC id
+                if ((*(const uint32_t*)(at + 4) & 1) && cpu_count < APIC_CPU_MAX) cpu_ids[cpu_count++] = at[3];
+                break;
+            case MADT_IOAPIC: {
+                uint32_t address = *(const uint32_t*)(at + 4);
+                if (ioapic_count < IOAPIC_MAX && map_physical(address, PAGING_PAGE_SIZE, PAGING_CACHE_UC)) {
+                    ioapic_t* io = &ioapics[ioapic_count++];
+                    io->regs = (volatile uint32_t*)address;
+                    io->gsi_base = *(const uint32_t*)(at + 8);
+                    io->gsi_count = ((ioapic_read(io, IOAPIC_VERSION) >> 16) & 0xFF) + 1;
+                }
+                break;
+            }
+            case MADT_OVERRIDE: {
+                // Bus, source IRQ, GSI, flags
+                uint8_t irq = at[3];
+                uint16_t flags = *(const uint16_t*)(at + 8);
+                if (at[2] != 0 || irq >= ISA_IRQS) break;
+                isa_gsi[irq] = *(const uint32_t*)(at + 4);
+                isa_bits[irq] = ((flags & MADT_POLARITY_LOW) == MADT_POLARITY_LOW ? REDIRECT_LOW_ACTIVE : 0) |
+                                ((flags & MADT_TRIGGER_LEVEL) == MADT_TRIGGER_LEVEL ? REDIRECT_LEVEL : 0);
+                break;
+            }
+            case MADT_LAPIC_ADDRESS:
+                if (!*(const uint32_t*)(at + 8)) *lapic_address = *(const uint32_t*)(at + 4);
+                break;
+        }
+        at += at[1];
+    }
+    return ioapic_count > 0;
+}
+
+static const ioapic_t* ioapic_for(uint32_t gsi) {
+    for (uint32_t i = 0; i < ioapic_count; i++) {
+        if (gsi >= ioapics[i].gsi_base && gsi < ioapics[i].gsi_base + ioapics[i].gsi_count) return &ioapics[i];
+    }
+    return 0;
+}
+
+/* Nothing through the 8259 virtual wire; errors and the timer off for now */
+static void lapic_setup(void) {
+    lapic_write(LAPIC_TPR, 0);
+    lapic_write(LAPIC_LVT_LINT0, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_LVT_ERROR, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_TIMER_INIT, 0);
+    lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE | APIC_SPURIOUS_VECTOR);
+}
+
+void apic_init(void) {
+    if (!cpu_has(CPU_FEATURE_APIC) || !cpu_has(CPU_FEATURE_MSR)) return;
+    
+    uint32_t lapic_address;
+    if (!madt_parse(&lapic_address)) return;
+    
+    // The MSR holds the base actually decoded; the MADT only reports it
+    uint64_t base = rdmsr(MSR_APIC_BASE);
+    lapic_address = (uint32_t)base & 0xFFFFF000;
+    if (!map_physical(lapic_address, PAGING_PAGE_SIZE, PAGING_CACHE_UC)) return;
+    wrmsr(MSR_APIC_BASE, base | APIC_BASE_ENABLE);
+    lapic = (volatile uint32_t*)lapic_address;
+    
+    uint32_t flags = irq_save();
+    pic_disable();
+    lapic_setup();
+    
+    // Every pin masked, then the ISA lines aimed at this CPU on 32-47
+    for (uint32_t i = 0; i < ioapic_count; i++) {
+        for (uint32_t pin = 0; pin < ioapics[i].gsi_count; pin++) {
+            ioapic_write(&ioapics[i], IOAPIC_REDIRECT + pin * 2, REDIRECT_MASKED);
+        }
+    }
+    uint32_t destination = (uint32_t)apic_id() << 24;
+    for (int irq = 0; irq < ISA_IRQS; irq++) {
+        const ioapic_t* io = ioapic_for(isa_gsi[irq]);
+        if (!io) continue;
+        
+        uint32_t pin = isa_gsi[irq] - io->gsi_base;
+        ioapic_write(io, IOAPIC_REDIRECT + pin * 2 + 1, destination);
+        ioapic_write(io, IOAPIC_REDIRECT + pin * 2, REDIRECT_MASKED | isa_bits[irq] | (PIC_IRQ_BASE + irq));
+    }
+    
+    enabled = 1;
+    irq_restore(flags);
+}
+
+void apic_init_ap(void) {
+    if (!enabled) return;
+    wrmsr(MSR_APIC_BASE, rdmsr(MSR_APIC_BASE) | APIC_BASE_ENABLE);
+    lapic_setup();
+}
+
+uint8_t apic_enabled(void) {
+    return enabled;
+}
+
+void apic_eoi(void) {
+    lapic_write(LAPIC_EOI, 0);
+}
+
+static void irq_set_masked(uint8_t irq, uint8_t masked) {
+    if (!enabled || irq >= ISA_IRQS) return;
+    const ioapic_t* io = ioapic_for(isa_gsi[irq]);
+    if (!io) return;
+    
+    uint32_t reg = IOAPIC_REDIRECT + (isa_gsi[irq] - io->gsi_base) * 2;
+    uint32_t flags = irq_save();
+    uint32_t low = ioapic_read(io, reg);
+    ioapic_write(io, reg, masked ? low | REDIRECT_MASKED : low & ~REDIRECT_MASKED);
+    irq_restore(flags);
+}
+
+void apic_irq_mask(uint8_t irq) {
+    irq_set_masked(irq, 1);
+}
+
+void apic_irq_unmask(uint8_t irq) {
+    irq_set_masked(irq, 0);
+}
+
+uint32_t apic_cpu_count(void) {
+    return cpu_count;
+}
+
+uint8_t apic_cpu_apic_id(uint32_t index) {
+    return index < cpu_count ? cpu_ids[index] : 0;
+}
+
+uint8_t apic_id(void) {
+    return lapic ? lapic_read(LAPIC_ID) >> 24 : 0;
+}
+
+static void send_ipi(uint8_t apic_id, uint32_t command) {
+    uint32_t flags = irq_save();
+    while (lapic_read(LAPIC_ICR_LOW) & ICR_PENDING) asm volatile ("pause");
+    lapic_write(LAPIC_ICR_HIGH, (uint32_t)apic_id << 24);
+    lapic_write(LAPIC_ICR_LOW, command);
+    irq_restore(flags);
+}
+
+void apic_send_ipi(uint8_t apic_id, uint8_t vector) {
+    send_ipi(apic_id, ICR_ASSERT | vector);
+}
+
+void apic_send_nmi(uint8_t apic_id) {
+    send_ipi(apic_id, ICR_ASSERT | ICR_NMI);
+}
+
+void apic_send_init(uint8_t apic_id) {
+    send_ipi(apic_id, ICR_ASSERT | ICR_INIT);
+}
+
+void apic_send_startup(uint8_t apic_id, uint32_t address) {
+    send_ipi(apic_id, ICR_ASSERT | ICR_STARTUP | (address >> 12));
+}
+
+uint8_t apic_timer_has_deadline(void) {
+    return enabled && cpu_has(CPU_FEATURE_TSC_DEADLINE);
+}
+
+void apic_timer_setup(uint8_t vector, uint8_t tsc_deadline) {
+    lapic_write(LAPIC_TIMER_DIV, LAPIC_TIMER_DIVIDE_1);
+    lapic_write(LAPIC_LVT_TIMER, vector | (tsc_deadline ? LAPIC_TIMER_DEADLINE : LAPIC_TIMER_ONESHOT));
+}
+
+void apic_timer_arm(uint32_t count) {
+    lapic_write(LAPIC_TIMER_INIT, count);
+}
+
+void apic_timer_arm_deadline(uint64_t tsc) {
+    wrmsr(MSR_TSC_DEADLINE, tsc);
+}
+
+uint32_t apic_timer_current(void) {
+    return lapic_read(LAPIC_TIMER_COUNT);
+}
@@ -0,0 +1,60 @@
+#include "../include/cpu.h"
+
+static cpu_info_t info;
+
+/* CPUID exists when the ID flag (EFLAGS bit 21) can be toggled */
+static uint8_t cpuid_supported(void) {
+    uint32_t before, after;
+    asm volatile ("pushfl\n\t"
+                  "popl %0\n\t"
+                  "movl %0, %1\n\t"
+                  "xorl $0x200000, %1\n\t"
+                  "pushl %1\n\t"
+                  "popfl\n\t"
+                  "pushfl\n\t"
+                  "popl %1\n\t"
+                  "pushl %0\n\t"
+                  "popfl"
+                  : "=&r"(before), "=&r"(after));
+    return ((before ^ after) & 0x200000) != 0;
+}
+
+void cpu_detect(void) {
+    uint32_t a, b, c, d;
+    
+    if (!cpuid_supported()) return;
+    
+    cpuid(0, &a, &b, &c, &d);
+    info.max_leaf = a;
+    uint32_t regs[3] = { b, d, c };
+    for (int i = 0; i < 12; i++) {
+        info.vendor[i] = (char)(regs[i / 4] >> ((i % 4) * 8));
+    }
+    info.vendor[12] = 0;
+    
+    if (info.max_leaf < 1) return;
+    
+    cpuid(1, &a, &b, &c, &d);
+    info.family = (a >> 8) & 0x0F;
+    info.model = (a >> 4) & 0x0F;
+    if (info.family == 0x0F) info.family += (a >> 20) & 0xFF;
+    if (info.family >= 0x06) info.model |= ((a >> 16) & 0x0F) << 4;
+    info.features_edx = d;
+    info.features_ecx = c;
+    
+    if (info.max_leaf < 7) return;
+    
+    cpuid(7, &a, &b, &c, &d);
+    info.features_ext_ebx = b;
+}
+
+uint8_t cpu_has(cpu_feature_t feature) {
+    uint32_t bit = (uint32_t)feature;
+    if (bit < 32) return (info.features_edx >> bit) & 1;
+    if (bit < 64) return (info.features_ecx >> (bit - 32)) & 1;
+    return (info.features_ext_ebx >> (bit - 64)) & 1;
+}
+
+const cpu_info_t* cpu_get_info(void) {
+    return &info;
+}
@@ -1,85 +1,563 @@
 #include "../include/field.h"
+#include "../include/runqueue.h"
+#include "../include/cpu.h"
+#include "../include/mem.h"
+#include "../include/io.h"
+#include "../include/slab.h"
+#include "../include/smp.h"
+#include "../include/spinlock.h"
+#include "../include/timer.h"
+#include "../include/trace.h"
 
-#define MAX_FIELDS 32
+#define FIELD_INDEX_MASK  (FIELD_MAX - 1)
 
-static cognitive_field_t fields[MAX_FIELDS];
-static uint32_t active_fields_count = 0;
+/* Handle table: the field in each slot, the slot's generation, and a
+   stack of free slot indices. field_lock covers it and stack_waiters; a
+   CPU's lock may be held when taking it, never the other way round. */
+static spinlock_t field_lock = SPINLOCK_INIT;
+static cognitive_field_t* slots[FIELD_MAX];
+static uint32_t slot_generation[FIELD_MAX];
+static uint16_t free_slots[FIELD_MAX];
+static uint32_t free_slot_count = 0;
+static uint32_t active_fields_count = 0;   /* Live fields */
+
+/* Fields and their stacks come from object caches. A field takes its
+   stack when it is first dispatched, so queued excitations cost no
+   stack until they run. */
+static kmem_cache_t* field_cache = 0;
+static kmem_cache_t* stack_cache = 0;
+
+/* Fields that came up for their first run while memory was short */
+static runqueue_t stack_waiters;
+
+/* Per-CPU scheduler state. The lock covers the queues, current and
+   reap_pending. It is held across a context switch and released by the
+   context that resumes on the CPU, so no other CPU can take a field
+   before its registers are saved. */
+typedef struct {
+    spinlock_t lock;
+    uint32_t index;
+    
+    /* Fields with energy left this epoch, and spent fields waiting for the next */
+    runqueue_t queues[2];
+    runqueue_t* active;
+    runqueue_t* expired;
+    
+    /* The idle context runs on the CPU's own stack and never leaves the
+       scheduler: the observer (GUI loop) on the boot CPU, the idle loop on
+       an AP. current is whoever owns the CPU. */
+    uint8_t idle_fpu[512] __attribute__((aligned(16)));
+    field_context_t idle;
+    field_context_t* current;
+    cognitive_field_t* current_field;   /* 0 while the idle context runs */
+    
+    /* A field that went dormant on its own stack; its stack and slot are
+       released by whoever runs next, once nothing executes on them any more */
+    cognitive_field_t* reap_pending;
+} field_cpu_t;
+
+static field_cpu_t boot_cpu;
+static field_cpu_t* volatile cpus[SMP_CPU_MAX];   /* Set once a CPU can schedule */
+static uint8_t scheduler_ready = 0;
+
+/* The observer lends the boot CPU to fields until its deadline */
+static volatile uint8_t observer_waiting = 0;
+static uint64_t observer_wake_ns = 0;
+
+/* FPU/SSE image a field starts from */
+static uint8_t fpu_initial[512] __attribute__((aligned(16)));
+static uint8_t use_fxsr = 0;
+
+extern void context_switch(uint32_t* save_esp, uint32_t load_esp);
 
 /* External output function from kernel.c (temporary for debugging) */
 extern void terminal_writestring(const char* data);
 
-void init_cognitive_fields(void) 
+static inline void fpu_save(uint8_t* image) {
+    if (use_fxsr) asm volatile ("fxsave (%0)" : : "r"(image) : "memory");
+    else asm volatile ("fnsave (%0); fwait" : : "r"(image) : "memory");
+}
+
+static inline void fpu_restore(const uint8_t* image) {
+    if (use_fxsr) asm volatile ("fxrstor (%0)" : : "r"(image) : "memory");
+    else asm volatile ("frstor (%0)" : : "r"(image) : "memory");
+}
+
+/* The state a field is freed in, so the cache only builds it once */
+static void field_ctor(void* object)
+{
+    cognitive_field_t* field = object;
+    field->id = 0;
+    field->state = FIELD_STATE_DORMANT;
+    field->stack = 0;
+    field->rq_owner = 0;
+    field->rq_next = field->rq_prev = 0;
+    field->doomed = 0;
+}
+
+/* Empty queues, with the idle context current */
+static void field_cpu_setup(field_cpu_t* cpu, uint32_t index)
+{
+    cpu->lock = (spinlock_t)SPINLOCK_INIT;
+    cpu->index = index;
+    runqueue_init(&cpu->queues[0]);
+    runqueue_init(&cpu->queues[1]);
+    cpu->active = &cpu->queues[0];
+    cpu->expired = &cpu->queues[1];
+    cpu->idle.esp = 0;
+    cpu->idle.fpu = cpu->idle_fpu;
+    cpu->current = &cpu->idle;
+    cpu->current_field = 0;
+    cpu->reap_pending = 0;
+}
+
+/* Interrupts must be off, or the caller may be on another CPU by now */
+static inline field_cpu_t* this_cpu(void)
+{
+    return cpus[smp_cpu_index()];
+}
+
+void init_cognitive_fields(void)
 {
     terminal_writestring("[ FIELD ] Quantizing Field Space... ");
-    for(int i=0; i<MAX_FIELDS; i++) {
-        fields[i].id = 0;
-        fields[i].state = FIELD_STATE_DORMANT;
-        fields[i].energy = 0;
+    memset(slots, 0, sizeof(slots));
+    for(uint32_t i=0; i<FIELD_MAX; i++) {
+        slot_generation[i] = 1;
+        free_slots[i] = FIELD_MAX - 1 - i;   // Slot 0 goes out first
     }
+    free_slot_count = FIELD_MAX;
     active_fields_count = 0;
+    
+    if (!field_cache) field_cache = kmem_cache_create("field", sizeof(cognitive_field_t), 16, field_ctor);
+    if (!stack_cache) stack_cache = kmem_cache_create("field_stack", FIELD_STACK_SIZE, 16, 0);
+    
+    runqueue_init(&stack_waiters);
+    field_cpu_setup(&boot_cpu, 0);
+    cpus[0] = &boot_cpu;
+    
+    // Capture a freshly reset FPU for new fields, keeping our own state
+    use_fxsr = cpu_has(CPU_FEATURE_FXSR);
+    fpu_save(boot_cpu.idle_fpu);
+    asm volatile ("fninit");
+    fpu_save(fpu_initial);
+    fpu_restore(boot_cpu.idle_fpu);
+    
+    scheduler_ready = 1;
     terminal_writestring("DONE.\n");
 }
 
-void create_excitation(const char* name, void (*function)(void), uint32_t initial_energy)
+/* Make a field runnable on cpu, whose lock is held. A spent field gets
+   its base energy back but waits for the next epoch. */
+static void field_enqueue(field_cpu_t* cpu, cognitive_field_t* field)
+{
+    field->state = FIELD_STATE_SUPERPOSITION;
+    if (field->energy == 0) {
+        field->energy = field->base_energy;
+        runqueue_push(cpu->expired, field);
+    } else {
+        runqueue_push(cpu->active, field);
+    }
+}
+
+/* Queued plus running; read without the lock, so only a hint */
+static inline uint32_t field_cpu_load(const field_cpu_t* cpu)
 {
-    if (active_fields_count >= MAX_FIELDS) return;
+    return cpu->queues[0].count + cpu->queues[1].count + (cpu->current_field != 0);
+}
+
+static void field_trampoline(void);
+
+/* Give a field its stack, laid out as context_switch() leaves it: EFLAGS,
+   edi, esi, ebx, ebp, return address (the trampoline) and a null frame
+   above that. Returns 0 when memory is short. */
+static uint8_t field_bind_stack(cognitive_field_t* field)
+{
+    uint8_t* stack = stack_cache ? kmem_cache_alloc(stack_cache) : 0;
+    if (!stack) return 0;
+    
+    field->stack = stack;
+    field->context.fpu = stack;
     
-    int index = active_fields_count++;
-    fields[index].id = index + 1;
-    fields[index].energy = initial_energy;
-    fields[index].state = FIELD_STATE_SUPERPOSITION;
-    fields[index].entry_point = function;
+    uint32_t* sp = (uint32_t*)(stack + FIELD_STACK_SIZE);
+    *--sp = 0;
+    *--sp = (uint32_t)field_trampoline;
+    *--sp = 0;       // ebp
+    *--sp = 0;       // ebx
+    *--sp = 0;       // esi
+    *--sp = 0;       // edi
+    *--sp = 0x002;   // EFLAGS, interrupts off
+    field->context.esp = (uint32_t)sp;
+    return 1;
+}
+
+static void field_free(field_cpu_t* cpu, cognitive_field_t* field);
+
+/* The most energetic field queued on another CPU, or 0. Victims are only
+   tried, never waited for: a held lock means that CPU is scheduling, and
+   the next tick looks again. */
+static cognitive_field_t* field_steal(field_cpu_t* cpu)
+{
+    uint32_t count = smp_cpu_count();
+    for (uint32_t i = 1; i < count; i++) {
+        field_cpu_t* victim = cpus[(cpu->index + i) % count];
+        if (!victim || !(victim->queues[0].count + victim->queues[1].count)) continue;
+        if (!spin_trylock(&victim->lock)) continue;
+        
+        cognitive_field_t* field = runqueue_pop(victim->active);
+        if (!field) field = runqueue_pop(victim->expired);
+        spin_unlock(&victim->lock);
+        if (field) return field;
+    }
+    return 0;
+}
+
+/* Most energetic runnable field for cpu, whose lock is held, or 0. Starts
+   a new epoch when this one is spent and steals once nothing is queued.
+   Destroyed fields are reclaimed here, and unstarted fields parked while
+   no stack is free. */
+static cognitive_field_t* field_pick(field_cpu_t* cpu)
+{
+    for (;;) {
+        if (!cpu->active->count && cpu->expired->count) {
+            runqueue_t* spent = cpu->active;
+            cpu->active = cpu->expired;
+            cpu->expired = spent;
+        }
+        
+        cognitive_field_t* field = runqueue_pop(cpu->active);
+        if (!field) field = field_steal(cpu);
+        if (!field) {
+            trace_instant(TRACE_FIELD_PICK, 0);
+            return 0;
+        }
+        
+        if (field->doomed) {
+            field_free(cpu, field);
+            continue;
+        }
+        if (field->stack || field_bind_stack(field)) {
+            trace_instant(TRACE_FIELD_PICK, field->id);
+            return field;
+        }
+        
+        spin_lock(&field_lock);
+        runqueue_push(&stack_waiters, field);
+        spin_unlock(&field_lock);
+    }
+}
+
+/* Return a field's stack (if it has one), slot and object. Nothing may
+   be running on the stack; cpu's lock is held. The slot's generation
+   moves on, so every handle to it goes stale. */
+static void field_free(field_cpu_t* cpu, cognitive_field_t* field)
+{
+    if (field->stack) {
+        kmem_cache_free(stack_cache, field->stack);
+        field->stack = 0;
+        
+        // The most energetic field waiting for a stack gets this one
+        spin_lock(&field_lock);
+        cognitive_field_t* waiting = runqueue_pop(&stack_waiters);
+        spin_unlock(&field_lock);
+        if (waiting) field_enqueue(cpu, waiting);
+    }
+    
+    spin_lock(&field_lock);
+    uint32_t index = field->id & FIELD_INDEX_MASK;
+    uint32_t generation = (slot_generation[index] + 1) & (0xFFFFFFFFu >> FIELD_HANDLE_INDEX_BITS);
+    slot_generation[index] = generation ? generation : 1;
+    slots[index] = 0;
+    free_slots[free_slot_count++] = index;
+    active_fields_count--;
+    spin_unlock(&field_lock);
+    
+    field->id = 0;
+    field->state = FIELD_STATE_DORMANT;
+    kmem_cache_free(field_cache, field);
+}
+
+/* The tail of every switch, run by the context that resumed: reclaim a
+   field that ended on the way out, then let other CPUs at the queues */
+static void switch_finish(void)
+{
+    field_cpu_t* cpu = this_cpu();
+    cognitive_field_t* dead = cpu->reap_pending;
+    if (dead) {
+        cpu->reap_pending = 0;
+        field_free(cpu, dead);
+    }
+    spin_unlock(&cpu->lock);
+}
+
+/* Hand cpu to next (0 = its idle context). The caller has already
+   requeued the current field if it stays runnable. Interrupts must be off
+   and cpu's lock held; the lock is dropped once the switch is complete.
+   Returns when something switches back to the caller, possibly on
+   another CPU. */
+static void switch_to(field_cpu_t* cpu, cognitive_field_t* next)
+{
+    field_context_t* from = cpu->current;
+    field_context_t* to = next ? &next->context : &cpu->idle;
+    
+    if (next) next->state = FIELD_STATE_COLLAPSED;
+    if (from == to) {
+        spin_unlock(&cpu->lock);
+        return;
+    }
+    
+    fpu_save(from->fpu);
+    cpu->current = to;
+    cpu->current_field = next;
+    
+    context_switch(&from->esp, to->esp);
+    
+    // Back on this context
+    switch_finish();
+    fpu_restore(from->fpu);
+}
+
+/* End the field running on cpu. Interrupts must be off and cpu's lock
+   held. Its slot is reclaimed by the next context once the CPU has left
+   its stack. */
+static void __attribute__((noreturn)) field_exit(field_cpu_t* cpu)
+{
+    cpu->current_field->state = FIELD_STATE_DORMANT;
+    cpu->reap_pending = cpu->current_field;
+    switch_to(cpu, field_pick(cpu));
+    
+    // A dormant field is never picked again
+    for (;;) hlt();
+}
+
+/* First code a new field runs. It arrives through context_switch() with
+   interrupts off, and goes dormant when its entry point returns. */
+static void field_trampoline(void)
+{
+    switch_finish();
+    void (*entry)(void) = this_cpu()->current_field->entry_point;
+    fpu_restore(fpu_initial);
+    sti();
+    
+    entry();
+    
+    cli();
+    field_cpu_t* cpu = this_cpu();
+    spin_lock(&cpu->lock);
+    field_exit(cpu);
+}
+
+field_handle_t create_excitation(const char* name, void (*function)(void), uint32_t initial_energy)
+{
+    // Fields and interrupt handlers can create fields, so keep the timer
+    // out while a slot is set up
+    uint32_t flags = spin_lock_irqsave(&field_lock);
+    cognitive_field_t* field = 0;
+    if (free_slot_count && field_cache) field = kmem_cache_alloc(field_cache);
+    if (!field) {
+        spin_unlock_irqrestore(&field_lock, flags);
+        return 0;
+    }
+    uint32_t index = free_slots[--free_slot_count];
+    slots[index] = field;
+    active_fields_count++;
+    
+    field->id = (slot_generation[index] << FIELD_HANDLE_INDEX_BITS) | index;
+    field->energy = initial_energy;
+    field->base_energy = initial_energy;
+    field->slice_ticks = 0;
+    field->run_ticks = 0;
+    field->entry_point = function;
+    field->doomed = 0;
     
     /* Simple string copy */
     int i = 0;
     while(name[i] && i < 31) {
-        fields[index].name[i] = name[i];
+        field->name[i] = name[i];
         i++;
     }
-    fields[index].name[i] = 0;
+    field->name[i] = 0;
+    
+    // The stack is bound on first dispatch
+    field->stack = 0;
+    field->context.esp = 0;
+    field_handle_t handle = field->id;
+    spin_unlock(&field_lock);
+    
+    // Queue it on the least busy CPU, and wake that one if it is not us
+    field_cpu_t* local = scheduler_ready ? this_cpu() : &boot_cpu;
+    field_cpu_t* target = local;
+    for (uint32_t c = 0; c < smp_cpu_count(); c++) {
+        if (cpus[c] && field_cpu_load(cpus[c]) < field_cpu_load(target)) target = cpus[c];
+    }
+    spin_lock(&target->lock);
+    field_enqueue(target, field);
+    spin_unlock(&target->lock);
+    if (target != local) smp_wake(target->index);
+    irq_restore(flags);
     
     terminal_writestring("[ FIELD ] New Excitation Created: ");
     terminal_writestring(name);
     terminal_writestring("\n");
+    return handle;
+}
+
+cognitive_field_t* field_lookup(field_handle_t handle)
+{
+    cognitive_field_t* field = slots[handle & FIELD_INDEX_MASK];
+    if (!handle || !field || field->id != handle || field->state == FIELD_STATE_DORMANT || field->doomed) return 0;
+    return field;
+}
+
+/* The handle goes stale at once. The field may be queued or running on
+   any CPU, so whichever CPU schedules it next reclaims it: when it is
+   picked, or at its next tick. */
+void field_destroy(field_handle_t handle)
+{
+    uint32_t flags = spin_lock_irqsave(&field_lock);
+    cognitive_field_t* field = field_lookup(handle);
+    if (!field) {
+        spin_unlock_irqrestore(&field_lock, flags);
+        return;
+    }
+    field->doomed = 1;
+    spin_unlock(&field_lock);
+    
+    field_cpu_t* cpu = this_cpu();
+    if (field == cpu->current_field) {
+        spin_lock(&cpu->lock);
+        field_exit(cpu);
+    }
+    irq_restore(flags);
+}
+
+uint32_t field_live_count(void)
+{
+    return active_fields_count;
 }
 
-/* The "Quantum Scheduler" 
+uint32_t field_usage(field_usage_t* out, uint32_t max)
+{
+    uint32_t count = 0;
+    uint32_t flags = spin_lock_irqsave(&field_lock);
+    for (uint32_t i = 0; i < FIELD_MAX && count < max; i++) {
+        cognitive_field_t* field = slots[i];
+        if (!field || field->state == FIELD_STATE_DORMANT || field->doomed) continue;
+        
+        field_usage_t* usage = &out[count++];
+        usage->id = field->id;
+        usage->run_ticks = field->run_ticks;
+        for (int c = 0; c < 32; c++) usage->name[c] = field->name[c];
+    }
+    spin_unlock_irqrestore(&field_lock, flags);
+    return count;
+}
+
+/* The "Quantum Scheduler"
    Instead of round-robin, we pick the field with highest ENERGY.
-   This simulates the collapse of the wavefunction to the most probable (energetic) state. */
+   This simulates the collapse of the wavefunction to the most probable (energetic) state.
+   Called from a field, this yields to whichever field now has the most energy;
+   fields of equal energy take turns. */
 void field_update_dynamics(void)
 {
-    /* In a real implementation, this would switch stacks. 
-       For now, we just simulate the selection logic. */
-       
-    uint32_t max_energy = 0;
-    int selected_index = -1;
-    
-    for(uint32_t i=0; i<active_fields_count; i++) {
-        if (fields[i].state == FIELD_STATE_SUPERPOSITION || fields[i].state == FIELD_STATE_COLLAPSED) {
-            if (fields[i].energy > max_energy) {
-                max_energy = fields[i].energy;
-                selected_index = i;
-            }
+    if (!scheduler_ready) return;
+    
+    uint32_t flags = irq_save();
+    field_cpu_t* cpu = this_cpu();
+    if (!cpu->current_field) {
+        irq_restore(flags);
+        return;
+    }
+    spin_lock(&cpu->lock);
+    field_enqueue(cpu, cpu->current_field);
+    switch_to(cpu, field_pick(cpu));
+    irq_restore(flags);
+}
+
+/* Observer idle: run fields until the deadline, halting when none is ready */
+void field_idle_until(uint64_t deadline_ns)
+{
+    while (timer_now_ns() < deadline_ns) {
+        cli();
+        cognitive_field_t* next = 0;
+        if (scheduler_ready) {
+            spin_lock(&boot_cpu.lock);
+            next = field_pick(&boot_cpu);
+            if (!next) spin_unlock(&boot_cpu.lock);
         }
+        if (!next) {
+            timer_halt(deadline_ns);
+            continue;
+        }
+        
+        observer_wake_ns = deadline_ns;
+        observer_waiting = 1;
+        switch_to(&boot_cpu, next);
+        observer_waiting = 0;
+        sti();
     }
+}
+
+void field_cpu_start(void)
+{
+    uint32_t index = smp_cpu_index();
+    if (index >= SMP_CPU_MAX || cpus[index]) return;
     
-    if (selected_index != -1) {
-        /* Collapse/Run the selected field */
-        fields[selected_index].state = FIELD_STATE_COLLAPSED;
-        
-        terminal_writestring("[ SCHEDULER ] Collapsing Field: ");
-        terminal_writestring(fields[selected_index].name);
-        terminal_writestring("\n");
-        
-        /* execute the cognitive function */
-        if (fields[selected_index].entry_point) {
-            fields[selected_index].entry_point();
+    field_cpu_t* cpu = kmalloc(sizeof(field_cpu_t));
+    if (!cpu) return;
+    field_cpu_setup(cpu, index);
+    cpus[index] = cpu;
+}
+
+void field_cpu_run(void)
+{
+    for (;;) {
+        cli();
+        field_cpu_t* cpu = scheduler_ready ? this_cpu() : 0;
+        cognitive_field_t* next = 0;
+        if (cpu) {
+            spin_lock(&cpu->lock);
+            next = field_pick(cpu);
+            if (!next) spin_unlock(&cpu->lock);
         }
-        
-        /* Decay energy (Entropy increases, useful energy dissipates) */
-        if (fields[selected_index].energy > 0)
-            fields[selected_index].energy--;
-            
-        /* Here we would perform the context switch */
+        if (!next) {
+            // The next tick, or a wake from another CPU, looks again
+            timer_halt(0);
+            continue;
+        }
+        switch_to(cpu, next);
+    }
+}
+
+/* Timer preemption. The idle context is never preempted. On the boot CPU
+   a field gives way to the observer once its deadline passes; everywhere
+   it gives way to a more energetic field at the end of each timeslice
+   (with its energy decayed). A destroyed field ends at its next tick. */
+void field_timer_tick(void)
+{
+    field_cpu_t* cpu = scheduler_ready ? this_cpu() : 0;
+    if (!cpu || !cpu->current_field) return;
+    
+    spin_lock(&cpu->lock);
+    cognitive_field_t* field = cpu->current_field;
+    if (field->doomed) field_exit(cpu);
+    field->run_ticks++;
+    
+    if (cpu == &boot_cpu && observer_waiting && timer_now_ns() >= observer_wake_ns) {
+        field_enqueue(cpu, field);
+        switch_to(cpu, 0);
+        return;
     }
+    
+    if (++field->slice_ticks < FIELD_TIMESLICE_TICKS) {
+        spin_unlock(&cpu->lock);
+        return;
+    }
+    field->slice_ticks = 0;
+    
+    /* Decay energy (Entropy increases, useful energy dissipates) */
+    if (field->energy > 0)
+        field->energy--;
+    
+    field_enqueue(cpu, field);
+    switch_to(cpu, field_pick(cpu));
 }
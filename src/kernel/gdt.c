@@ -2,7 +2,7 @@
 
 extern void gdt_flush(uint32_t);
 
-gdt_entry_t gdt_entries[5];
+gdt_entry_t gdt_entries[GDT_ENTRIES];
 gdt_ptr_t   gdt_ptr;
 
 static void gdt_set_gate(int32_t num, uint32_t base, uint32_t limit, uint8_t access, uint8_t gran) {
@@ -18,7 +18,7 @@ static void gdt_set_gate(int32_t num, uint32_t base, uint32_t limit, uint8_t acc
 }
 
 void init_gdt() {
-    gdt_ptr.limit = (sizeof(gdt_entry_t) * 5) - 1;
+    gdt_ptr.limit = (sizeof(gdt_entry_t) * GDT_ENTRIES) - 1;
     gdt_ptr.base  = (uint32_t)&gdt_entries;
 
     gdt_set_gate(0, 0, 0, 0, 0);                // Null segment
@@ -29,3 +29,12 @@ void init_gdt() {
 
     gdt_flush((uint32_t)&gdt_ptr);
 }
+
+void gdt_load() {
+    gdt_flush((uint32_t)&gdt_ptr);
+}
+
+uint16_t gdt_set_cpu_segment(uint32_t cpu, uint32_t base, uint32_t size) {
+    gdt_set_gate(GDT_CPU_FIRST + cpu, base, size - 1, 0x92, 0x40);   // Byte granular
+    return (GDT_CPU_FIRST + cpu) * sizeof(gdt_entry_t);
+}
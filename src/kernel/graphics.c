@@ -1,6 +1,16 @@
 #include "../include/graphics.h"
+#include "../include/pixel.h"
+#include "../include/mem.h"
+#include "../include/pmm.h"
+#include "../include/slab.h"
+#include "../include/smp.h"
+#include "../include/trace.h"
 
 static graphics_context_t ctx = {0};
+static graphics_blend_mode_t blend_mode = GRAPHICS_BLEND_NONE;
+static uint8_t capturing = 0;           /* An off-screen surface is the target */
+static uint8_t panicking = 0;           /* graphics_panic(): no recording, no other CPUs */
+static graphics_context_t screen;       /* Back buffer geometry while capturing */
 
 /* Simple 8x8 bitmap font (ASCII 32-127) */
 static const uint8_t font_8x8[96][8] = {
@@ -102,16 +112,392 @@ static const uint8_t font_8x8[96][8] = {
     {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}  // DEL
 };
 
+/* Glyph atlas
+   Built once from font_8x8: each glyph row as a column mask (bit i is
+   column i) plus its runs of set pixels, packed start << 4 | length. */
+typedef struct {
+    uint8_t mask[8];
+    uint8_t run_count[8];
+    uint8_t runs[8][4];
+} glyph_t;
+
+static glyph_t glyph_atlas[96];
+static uint8_t atlas_ready = 0;
+
+static void build_glyph_atlas(void) {
+    for (int g = 0; g < 96; g++) {
+        glyph_t* glyph = &glyph_atlas[g];
+        for (int row = 0; row < 8; row++) {
+            uint8_t bits = font_8x8[g][row];
+            uint8_t mask = 0;
+            uint8_t count = 0;
+            int col = 0;
+            
+            while (col < 8) {
+                if (!(bits & (1 << (7 - col)))) {
+                    col++;
+                    continue;
+                }
+                int start = col;
+                while (col < 8 && (bits & (1 << (7 - col)))) {
+                    mask |= 1 << col;
+                    col++;
+                }
+                glyph->runs[row][count++] = (start << 4) | (col - start);
+            }
+            glyph->mask[row] = mask;
+            glyph->run_count[row] = count;
+        }
+    }
+    atlas_ready = 1;
+}
+
+static inline const glyph_t* glyph_for(char c) {
+    if (c < 32 || c > 126) c = ' ';
+    return &glyph_atlas[c - 32];
+}
+
+/* Damage tracking
+   Every primitive records the screen box it touched. Overlapping boxes are
+   merged so the list stays short; graphics_clear() and graphics_present()
+   then only walk the union of this frame's and last frame's boxes. */
+#define GRAPHICS_MAX_DAMAGE 16
+
+typedef struct {
+    graphics_rect_t rects[GRAPHICS_MAX_DAMAGE];
+    uint32_t count;
+} damage_list_t;
+
+static damage_list_t frame_damage;      /* Drawn since the last present */
+static damage_list_t last_damage;       /* Drawn in the frame on screen */
+static uint8_t full_damage = 1;         /* Whole screen must be presented */
+static uint8_t clear_valid = 0;         /* Back buffer outside damage == clear_color */
+static color_t clear_color = 0;
+static graphics_frame_stats_t frame_stats;
+static uint32_t pixels_cleared_pending = 0;
+
+static inline uint32_t rect_area(const graphics_rect_t* r) {
+    return (r->x1 - r->x0) * (r->y1 - r->y0);
+}
+
+static inline uint8_t rect_touches(const graphics_rect_t* a, const graphics_rect_t* b) {
+    return a->x0 <= b->x1 && b->x0 <= a->x1 && a->y0 <= b->y1 && b->y0 <= a->y1;
+}
+
+static inline void rect_union(graphics_rect_t* a, const graphics_rect_t* b) {
+    if (b->x0 < a->x0) a->x0 = b->x0;
+    if (b->y0 < a->y0) a->y0 = b->y0;
+    if (b->x1 > a->x1) a->x1 = b->x1;
+    if (b->y1 > a->y1) a->y1 = b->y1;
+}
+
+static void damage_list_add(damage_list_t* list, graphics_rect_t r) {
+    // Absorb every box the new one touches; a grown box may touch more
+    uint32_t i = 0;
+    while (i < list->count) {
+        if (rect_touches(&list->rects[i], &r)) {
+            rect_union(&r, &list->rects[i]);
+            list->rects[i] = list->rects[--list->count];
+            i = 0;
+        } else {
+            i++;
+        }
+    }
+    
+    if (list->count < GRAPHICS_MAX_DAMAGE) {
+        list->rects[list->count++] = r;
+        return;
+    }
+    
+    // List full: fold into the box that grows the least
+    uint32_t best = 0;
+    uint32_t best_growth = 0xFFFFFFFF;
+    for (i = 0; i < list->count; i++) {
+        graphics_rect_t u = list->rects[i];
+        rect_union(&u, &r);
+        uint32_t growth = rect_area(&u) - rect_area(&list->rects[i]);
+        if (growth < best_growth) {
+            best_growth = growth;
+            best = i;
+        }
+    }
+    graphics_rect_t merged = list->rects[best];
+    rect_union(&merged, &r);
+    list->rects[best] = list->rects[--list->count];
+    damage_list_add(list, merged);
+}
+
+/* Record a box in screen coordinates (may be partly off-screen) */
+static void damage_add(int32_t x, int32_t y, int32_t w, int32_t h) {
+    if (capturing || w <= 0 || h <= 0) return;
+    
+    int32_t x1 = x + w;
+    int32_t y1 = y + h;
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    if (x1 > (int32_t)ctx.width) x1 = ctx.width;
+    if (y1 > (int32_t)ctx.height) y1 = ctx.height;
+    if (x >= x1 || y >= y1) return;
+    
+    graphics_rect_t r = { (uint32_t)x, (uint32_t)y, (uint32_t)x1, (uint32_t)y1 };
+    damage_list_add(&frame_damage, r);
+}
+
+/* Command list
+   Screen drawing is recorded rather than done: each primitive appends a
+   command and links it into the bin of every tile its box overlaps.
+   graphics_flush() hands the tiles out to every CPU, and each bin is
+   replayed clipped to its tile in recording order, so draws that
+   overlap land as they were made. While a surface is the target, or
+   without the bins, primitives draw at once instead. */
+#define GRAPHICS_MAX_COMMANDS   512
+#define GRAPHICS_BIN_ENTRIES    8192
+#define GRAPHICS_PAYLOAD_BYTES  16384   /* Copied text runs and sprite headers */
+#define BIN_END                 0xFFFF
+
+typedef enum {
+    CMD_BOX,
+    CMD_PIXEL,
+    CMD_CIRCLE,
+    CMD_FILL_CIRCLE,
+    CMD_LINE,
+    CMD_GLYPH,
+    CMD_TEXT_RUN,
+    CMD_SPRITE
+} command_op_t;
+
+typedef struct {
+    uint8_t op;
+    uint8_t blend;
+    char glyph;
+    color_t color;
+    int32_t x0, y0, x1, y1;   /* Box corners, line ends; x0, y0 alone place the rest */
+    int32_t radius;
+    const void* data;         /* Text run or sprite header */
+} command_t;
+
+typedef struct {
+    uint16_t command;
+    uint16_t next;
+} bin_entry_t;
+
+static command_t commands[GRAPHICS_MAX_COMMANDS];
+static uint32_t command_count = 0;
+static bin_entry_t bin_entries[GRAPHICS_BIN_ENTRIES];
+static uint32_t bin_entry_count = 0;
+static uint8_t payload[GRAPHICS_PAYLOAD_BYTES] __attribute__((aligned(16)));
+static uint32_t payload_used = 0;
+
+/* Per tile, the first and last entry of its bin, or BIN_END */
+static uint16_t* bin_first = 0;
+static uint16_t* bin_last = 0;
+static uint32_t tiles_x = 0;
+static uint32_t tile_count = 0;
+static volatile uint32_t next_tile = 0;   /* Handed out by graphics_flush() */
+
+static uint32_t commands_pending = 0;
+static uint32_t tiles_pending = 0;
+
+/* Span engine
+   Rasterisers draw through a raster_t: the rows of the target, the box
+   they may touch and whether translucent colors composite. Primitives
+   clip once, then hand whole rows to fill_span(). Rows are addressed
+   through the stride so padded scanlines are never skewed. */
+typedef struct {
+    uint32_t* pixels;
+    uint32_t stride;
+    int32_t x0, y0, x1, y1;  /* Clip, half-open */
+    uint8_t blend;           /* Translucent colors composite */
+} raster_t;
+
+static inline uint32_t* raster_row(const raster_t* r, int32_t y) {
+    return r->pixels + y * r->stride;
+}
+
+static inline uint8_t blends(const raster_t* r, color_t color) {
+    return r->blend && (color >> 24) != 0xFF;
+}
+
+static inline void fill_span(const raster_t* r, uint32_t* row, uint32_t x0, uint32_t x1, color_t color) {
+    uint32_t* p = row + x0;
+    uint32_t n = x1 - x0;
+    
+    if (blends(r, color)) {
+        pixel_ops.blend_solid(p, color, n);
+        return;
+    }
+    
+    // Short spans (glyph rows, circle caps) are cheaper without a call
+    if (n < 8) {
+        while (n--) *p++ = color;
+        return;
+    }
+    pixel_ops.fill(p, color, n);
+}
+
+/* Fill [x0, x1) on row y after clipping */
+static inline void fill_span_clipped(const raster_t* r, int32_t y, int32_t x0, int32_t x1, color_t color) {
+    if (y < r->y0 || y >= r->y1) return;
+    if (x0 < r->x0) x0 = r->x0;
+    if (x1 > r->x1) x1 = r->x1;
+    if (x0 >= x1) return;
+    
+    fill_span(r, raster_row(r, y), x0, x1, color);
+}
+
+/* Clip a box; returns 0 when nothing is left */
+static inline uint8_t clip_box(const raster_t* r, int32_t* x0, int32_t* y0, int32_t* x1, int32_t* y1) {
+    if (*x0 < r->x0) *x0 = r->x0;
+    if (*y0 < r->y0) *y0 = r->y0;
+    if (*x1 > r->x1) *x1 = r->x1;
+    if (*y1 > r->y1) *y1 = r->y1;
+    return *x0 < *x1 && *y0 < *y1;
+}
+
+static void fill_box(const raster_t* r, int32_t x0, int32_t y0, int32_t x1, int32_t y1, color_t color) {
+    if (!clip_box(r, &x0, &y0, &x1, &y1)) return;
+    
+    uint32_t* row = raster_row(r, y0);
+    for (int32_t y = y0; y < y1; y++) {
+        fill_span(r, row, x0, x1, color);
+        row += r->stride;
+    }
+}
+
+/* Present converters: one back buffer row to one framebuffer row */
+static void present_row_32(uint8_t* dst, const uint32_t* src, uint32_t n) {
+    pixel_ops.stream((uint32_t*)dst, src, n);
+}
+
+static void present_row_24(uint8_t* dst, const uint32_t* src, uint32_t n) {
+    // Four pixels pack into three words once the destination is aligned
+    while (n && ((uint32_t)dst & 3)) {
+        uint32_t c = *src++;
+        dst[0] = c;
+        dst[1] = c >> 8;
+        dst[2] = c >> 16;
+        dst += 3;
+        n--;
+    }
+    uint32_t* d = (uint32_t*)dst;
+    while (n >= 4) {
+        uint32_t c0 = src[0] & 0xFFFFFF;
+        uint32_t c1 = src[1] & 0xFFFFFF;
+        uint32_t c2 = src[2] & 0xFFFFFF;
+        uint32_t c3 = src[3] & 0xFFFFFF;
+        d[0] = c0 | (c1 << 24);
+        d[1] = (c1 >> 8) | (c2 << 16);
+        d[2] = (c2 >> 16) | (c3 << 8);
+        d += 3;
+        src += 4;
+        n -= 4;
+    }
+    dst = (uint8_t*)d;
+    while (n--) {
+        uint32_t c = *src++;
+        dst[0] = c;
+        dst[1] = c >> 8;
+        dst[2] = c >> 16;
+        dst += 3;
+    }
+}
+
+static inline uint16_t pack_565(uint32_t c) {
+    return ((c >> 8) & 0xF800) | ((c >> 5) & 0x07E0) | ((c >> 3) & 0x001F);
+}
+
+static inline uint16_t pack_555(uint32_t c) {
+    return ((c >> 9) & 0x7C00) | ((c >> 6) & 0x03E0) | ((c >> 3) & 0x001F);
+}
+
+static void present_row_16(uint8_t* dst, const uint32_t* src, uint32_t n) {
+    uint16_t* d = (uint16_t*)dst;
+    if (n && ((uint32_t)d & 2)) {
+        *d++ = pack_565(*src++);
+        n--;
+    }
+    // Two pixels per word store
+    uint32_t* w = (uint32_t*)d;
+    while (n >= 2) {
+        *w++ = pack_565(src[0]) | ((uint32_t)pack_565(src[1]) << 16);
+        src += 2;
+        n -= 2;
+    }
+    if (n) *(uint16_t*)w = pack_565(*src);
+}
+
+static void present_row_15(uint8_t* dst, const uint32_t* src, uint32_t n) {
+    uint16_t* d = (uint16_t*)dst;
+    if (n && ((uint32_t)d & 2)) {
+        *d++ = pack_555(*src++);
+        n--;
+    }
+    uint32_t* w = (uint32_t*)d;
+    while (n >= 2) {
+        *w++ = pack_555(src[0]) | ((uint32_t)pack_555(src[1]) << 16);
+        src += 2;
+        n -= 2;
+    }
+    if (n) *(uint16_t*)w = pack_555(*src);
+}
+
+static void (*present_row)(uint8_t* dst, const uint32_t* src, uint32_t n) = present_row_32;
+static uint32_t fb_bytes_per_pixel = 4;
+
 void graphics_init(uint32_t addr, uint32_t width, uint32_t height, uint32_t pitch, uint8_t bpp) {
+    if (addr == 0 || width == 0 || height == 0) return;
+    
+    switch (bpp) {
+        case 32: present_row = present_row_32; fb_bytes_per_pixel = 4; break;
+        case 24: present_row = present_row_24; fb_bytes_per_pixel = 3; break;
+        case 16: present_row = present_row_16; fb_bytes_per_pixel = 2; break;
+        case 15: present_row = present_row_15; fb_bytes_per_pixel = 2; break;
+        default: return; // Palettised modes are not supported
+    }
+    
+    pixel_init();
+    build_glyph_atlas();
+    
     ctx.framebuffer = (uint32_t*)addr;
     ctx.width = width;
     ctx.height = height;
     ctx.pitch = pitch;
     ctx.bpp = bpp;
+    
+    // Off-screen frame in system RAM, sized to the mode. All primitives
+    // draw here and graphics_present() pushes the result to video memory
+    // in one pass. Without the RAM for it a 32bpp mode is drawn in place;
+    // other formats need the conversion and stay in text mode.
+    uint32_t pages = (width * height * 4 + PMM_PAGE_SIZE - 1) >> PMM_PAGE_SHIFT;
+    uint32_t store = pmm_alloc_pages(pages);
+    if (store) {
+        ctx.backbuffer = (uint32_t*)store;
+        ctx.stride = width;
+    } else if (bpp == 32) {
+        ctx.backbuffer = ctx.framebuffer;
+        ctx.stride = pitch / 4;
+    } else {
+        return;
+    }
     ctx.initialized = 1;
     
+    // Command list bins, one per tile. Without them the screen is drawn
+    // immediately, on this CPU alone.
+    tiles_x = (width + GRAPHICS_TILE_SIZE - 1) >> GRAPHICS_TILE_SHIFT;
+    tile_count = tiles_x * ((height + GRAPHICS_TILE_SIZE - 1) >> GRAPHICS_TILE_SHIFT);
+    bin_first = kmalloc(tile_count * 2 * sizeof(uint16_t));
+    if (bin_first) {
+        bin_last = bin_first + tile_count;
+        for (uint32_t i = 0; i < tile_count; i++) bin_first[i] = BIN_END;
+    }
+    
+    frame_damage.count = 0;
+    last_damage.count = 0;
+    clear_valid = 0;
+    
     // Clear to deep space
     graphics_clear(COLOR_SPACE_DEEP);
+    graphics_present();
 }
 
 uint8_t graphics_is_available(void) {
@@ -126,63 +512,42 @@ uint32_t graphics_get_height(void) {
     return ctx.height;
 }
 
-void graphics_clear(color_t color) {
-    if (!ctx.initialized) return;
-    
-    for (uint32_t i = 0; i < ctx.width * ctx.height; i++) {
-        ctx.framebuffer[i] = color;
-    }
-}
-
-void graphics_put_pixel(uint32_t x, uint32_t y, color_t color) {
-    if (!ctx.initialized) return;
-    if (x >= ctx.width || y >= ctx.height) return;
+static inline void plot(const raster_t* r, int32_t x, int32_t y, color_t color) {
+    if (x < r->x0 || x >= r->x1 || y < r->y0 || y >= r->y1) return;
     
-    ctx.framebuffer[y * ctx.width + x] = color;
+    uint32_t* p = raster_row(r, y) + x;
+    *p = blends(r, color) ? pixel_blend_one(*p, color) : color;
 }
 
-void graphics_draw_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h, color_t color) {
-    if (!ctx.initialized) return;
-    
-    // Top and bottom
-    for (uint32_t i = 0; i < w; i++) {
-        graphics_put_pixel(x + i, y, color);
-        graphics_put_pixel(x + i, y + h - 1, color);
-    }
-    
-    // Left and right
-    for (uint32_t i = 0; i < h; i++) {
-        graphics_put_pixel(x, y + i, color);
-        graphics_put_pixel(x + w - 1, y + i, color);
+/* The eight octant reflections of (x, y). Points on the axes and the
+   diagonals are written once, so translucent outlines don't double-blend. */
+static inline void plot8(const raster_t* r, int32_t cx, int32_t cy, int x, int y, color_t color) {
+    plot(r, cx + x, cy + y, color);
+    if (x != 0) plot(r, cx - x, cy + y, color);
+    if (y != 0) {
+        plot(r, cx + x, cy - y, color);
+        plot(r, cx - x, cy - y, color);
     }
-}
-
-void graphics_fill_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h, color_t color) {
-    if (!ctx.initialized) return;
-    
-    for (uint32_t j = 0; j < h; j++) {
-        for (uint32_t i = 0; i < w; i++) {
-            graphics_put_pixel(x + i, y + j, color);
+    if (x != y) {
+        plot(r, cx + y, cy + x, color);
+        plot(r, cx + y, cy - x, color);
+        if (y != 0) {
+            plot(r, cx - y, cy + x, color);
+            plot(r, cx - y, cy - x, color);
         }
     }
 }
 
-void graphics_draw_circle(uint32_t cx, uint32_t cy, uint32_t radius, color_t color) {
-    if (!ctx.initialized) return;
+static void raster_circle(const raster_t* r, int32_t cx, int32_t cy, int32_t radius, color_t color) {
+    // Wholly outside the clip: every plot would be rejected
+    if (cx + radius < r->x0 || cx - radius >= r->x1 || cy + radius < r->y0 || cy - radius >= r->y1) return;
     
     int x = radius;
     int y = 0;
     int err = 0;
     
     while (x >= y) {
-        graphics_put_pixel(cx + x, cy + y, color);
-        graphics_put_pixel(cx + y, cy + x, color);
-        graphics_put_pixel(cx - y, cy + x, color);
-        graphics_put_pixel(cx - x, cy + y, color);
-        graphics_put_pixel(cx - x, cy - y, color);
-        graphics_put_pixel(cx - y, cy - x, color);
-        graphics_put_pixel(cx + y, cy - x, color);
-        graphics_put_pixel(cx + x, cy - y, color);
+        plot8(r, cx, cy, x, y, color);
         
         if (err <= 0) {
             y += 1;
@@ -195,29 +560,41 @@ void graphics_draw_circle(uint32_t cx, uint32_t cy, uint32_t radius, color_t col
     }
 }
 
-void graphics_fill_circle(uint32_t cx, uint32_t cy, uint32_t radius, color_t color) {
-    if (!ctx.initialized) return;
-    
-    for (int y = -radius; y <= (int)radius; y++) {
-        for (int x = -radius; x <= (int)radius; x++) {
-            if (x*x + y*y <= (int)(radius*radius)) {
-                graphics_put_pixel(cx + x, cy + y, color);
-            }
+static void raster_fill_circle(const raster_t* r, int32_t cx, int32_t cy, int32_t radius, color_t color) {
+    // Midpoint walk: half-width hw is the largest value with
+    // hw^2 + dy^2 <= r^2, tracked through the slack d = r^2 - dy^2 - hw^2
+    int32_t hw = radius;
+    int32_t d = 0;
+    for (int32_t dy = 0; dy <= radius; dy++) {
+        if (dy > 0) d -= 2 * dy - 1;
+        while (d < 0) {
+            d += 2 * hw - 1;
+            hw--;
         }
+        
+        int32_t x0 = cx - hw;
+        int32_t x1 = cx + hw + 1;
+        fill_span_clipped(r, cy + dy, x0, x1, color);
+        if (dy > 0) fill_span_clipped(r, cy - dy, x0, x1, color);
     }
 }
 
-void graphics_draw_line(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, color_t color) {
-    if (!ctx.initialized) return;
-    
+static void raster_line(const raster_t* r, int32_t x1, int32_t y1, int32_t x2, int32_t y2, color_t color) {
     int dx = x2 > x1 ? x2 - x1 : x1 - x2;
     int dy = y2 > y1 ? y2 - y1 : y1 - y2;
     int sx = x1 < x2 ? 1 : -1;
     int sy = y1 < y2 ? 1 : -1;
     int err = dx - dy;
     
+    // Axis-aligned lines are a single span or column
+    if (dy == 0) {
+        int32_t x0 = x1 < x2 ? x1 : x2;
+        fill_span_clipped(r, y1, x0, x0 + dx + 1, color);
+        return;
+    }
+    
     while (1) {
-        graphics_put_pixel(x1, y1, color);
+        plot(r, x1, y1, color);
         
         if (x1 == x2 && y1 == y2) break;
         
@@ -233,66 +610,619 @@ void graphics_draw_line(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, colo
     }
 }
 
-void graphics_draw_char(uint32_t x, uint32_t y, char c, color_t color) {
-    if (!ctx.initialized) return;
-    if (c < 32 || c > 126) c = ' ';
+static void raster_glyph(const raster_t* r, int32_t x, int32_t y, char c, color_t color) {
+    const glyph_t* glyph = glyph_for(c);
     
-    const uint8_t* glyph = font_8x8[c - 32];
+    for (int row = 0; row < 8; row++) {
+        for (int i = 0; i < glyph->run_count[row]; i++) {
+            uint8_t run = glyph->runs[row][i];
+            int32_t x0 = x + (run >> 4);
+            fill_span_clipped(r, y + row, x0, x0 + (run & 0x0F), color);
+        }
+    }
+}
+
+static void raster_text_run(const raster_t* r, const graphics_text_run_t* run, color_t color) {
+    uint32_t words = (run->length * 8 + 31) / 32;
     
     for (int row = 0; row < 8; row++) {
-        for (int col = 0; col < 8; col++) {
-            if (glyph[row] & (1 << (7 - col))) {
-                graphics_put_pixel(x + col, y + row, color);
+        int32_t y = run->y + row;
+        int32_t open = -1;  // Start of a span still running at the word edge
+        if (y < r->y0 || y >= r->y1) continue;
+        
+        for (uint32_t w = 0; w < words; w++) {
+            uint32_t bits = run->rows[row][w];
+            uint32_t pos = 0;
+            
+            while (pos < 32) {
+                if (open < 0) {
+                    uint32_t rest = bits >> pos;
+                    if (!rest) break;
+                    pos += __builtin_ctz(rest);
+                    open = w * 32 + pos;
+                }
+                uint32_t gaps = ~bits >> pos;
+                if (!gaps) break;  // Span continues into the next word
+                pos += __builtin_ctz(gaps);
+                fill_span_clipped(r, y, run->x + open, run->x + (int32_t)(w * 32 + pos), color);
+                open = -1;
             }
         }
+        if (open >= 0) {
+            fill_span_clipped(r, y, run->x + open, run->x + (int32_t)(words * 32), color);
+        }
+    }
+}
+
+/* One clipped sprite span: opaque colors fill, translucent ones blend */
+static inline void sprite_span(const raster_t* r, uint32_t* p, uint32_t n, color_t color, pixel_premul_t src) {
+    if (src.inv_alpha == 0) {
+        fill_span(r, p, 0, n, color);
+        return;
+    }
+    
+    // Ring outlines are mostly single pixels; a kernel call only pays off for long runs
+    if (n >= 16) {
+        pixel_ops.blend_solid(p, color, n);
+        return;
+    }
+    while (n--) {
+        *p = pixel_blend_premul(*p, src);
+        p++;
+    }
+}
+
+static void raster_sprite(const raster_t* r, const graphics_sprite_t* sprite, int32_t x, int32_t y) {
+    if (x + sprite->x1 <= r->x0 || x + sprite->x0 >= r->x1 ||
+        y + sprite->y1 <= r->y0 || y + sprite->y0 >= r->y1) return;
+    
+    // Palette colors are premultiplied once, not per span
+    pixel_premul_t premul[GRAPHICS_SPRITE_COLORS];
+    for (uint32_t i = 0; i < sprite->color_count; i++) {
+        premul[i] = pixel_premultiply(sprite->palette[i]);
+    }
+    
+    const graphics_span_t* s = sprite->spans;
+    const graphics_span_t* end = s + sprite->span_count;
+    
+    // Wholly inside the clip: spans go straight to their pixels
+    if (x + sprite->x0 >= r->x0 && y + sprite->y0 >= r->y0 &&
+        x + sprite->x1 <= r->x1 && y + sprite->y1 <= r->y1) {
+        uint32_t* origin = raster_row(r, y) + x;
+        int32_t stride = r->stride;
+        
+        for (; s < end; s++) {
+            sprite_span(r, origin + s->y * stride + s->x, s->length,
+                        sprite->palette[s->color], premul[s->color]);
+        }
+        return;
+    }
+    
+    // Spans are stored top to bottom: skip to the first row in the clip
+    const graphics_span_t* lo = s;
+    const graphics_span_t* hi = end;
+    while (lo < hi) {
+        const graphics_span_t* mid = lo + (hi - lo) / 2;
+        if (y + mid->y < r->y0) lo = mid + 1;
+        else hi = mid;
+    }
+    
+    for (s = lo; s < end; s++) {
+        int32_t sy = y + s->y;
+        if (sy >= r->y1) break;
+        
+        int32_t x0 = x + s->x;
+        int32_t x1 = x0 + s->length;
+        if (x0 < r->x0) x0 = r->x0;
+        if (x1 > r->x1) x1 = r->x1;
+        if (x0 >= x1) continue;
+        
+        sprite_span(r, raster_row(r, sy) + x0, x1 - x0, sprite->palette[s->color], premul[s->color]);
+    }
+}
+
+static void command_draw(raster_t* r, const command_t* cmd) {
+    r->blend = cmd->blend;
+    
+    switch (cmd->op) {
+        case CMD_BOX:         fill_box(r, cmd->x0, cmd->y0, cmd->x1, cmd->y1, cmd->color); break;
+        case CMD_PIXEL:       plot(r, cmd->x0, cmd->y0, cmd->color); break;
+        case CMD_CIRCLE:      raster_circle(r, cmd->x0, cmd->y0, cmd->radius, cmd->color); break;
+        case CMD_FILL_CIRCLE: raster_fill_circle(r, cmd->x0, cmd->y0, cmd->radius, cmd->color); break;
+        case CMD_LINE:        raster_line(r, cmd->x0, cmd->y0, cmd->x1, cmd->y1, cmd->color); break;
+        case CMD_GLYPH:       raster_glyph(r, cmd->x0, cmd->y0, cmd->glyph, cmd->color); break;
+        case CMD_TEXT_RUN:    raster_text_run(r, cmd->data, cmd->color); break;
+        case CMD_SPRITE:      raster_sprite(r, cmd->data, cmd->x0, cmd->y0); break;
+    }
+}
+
+static void raster_tile(uint32_t tile) {
+    uint32_t entry = bin_first[tile];
+    if (entry == BIN_END) return;
+    
+    // The screen, even if a surface is the target right now
+    const graphics_context_t* target = capturing ? &screen : &ctx;
+    raster_t r;
+    r.pixels = target->backbuffer;
+    r.stride = target->stride;
+    r.x0 = (tile % tiles_x) << GRAPHICS_TILE_SHIFT;
+    r.y0 = (tile / tiles_x) << GRAPHICS_TILE_SHIFT;
+    r.x1 = r.x0 + GRAPHICS_TILE_SIZE;
+    r.y1 = r.y0 + GRAPHICS_TILE_SIZE;
+    if (r.x1 > (int32_t)target->width) r.x1 = target->width;
+    if (r.y1 > (int32_t)target->height) r.y1 = target->height;
+    
+    for (; entry != BIN_END; entry = bin_entries[entry].next) {
+        command_draw(&r, &commands[bin_entries[entry].command]);
     }
 }
 
+/* Run on every CPU: take tiles until none are left */
+static void raster_tiles(void* arg) {
+    (void)arg;
+    for (;;) {
+        uint32_t tile = __atomic_fetch_add(&next_tile, 1, __ATOMIC_RELAXED);
+        if (tile >= tile_count) return;
+        raster_tile(tile);
+    }
+}
+
+void graphics_flush(void) {
+    if (!command_count || panicking) return;
+    
+    next_tile = 0;
+    if (!smp_call(raster_tiles, 0)) return;   // Off the boot CPU or inside a flush
+    
+    // Every CPU is done: empty the bins for the next batch
+    for (uint32_t i = 0; i < tile_count; i++) {
+        if (bin_first[i] == BIN_END) continue;
+        bin_first[i] = BIN_END;
+        tiles_pending++;
+    }
+    commands_pending += command_count;
+    command_count = 0;
+    bin_entry_count = 0;
+    payload_used = 0;
+}
+
+/* Draw cmd over [x0, x1) x [y0, y1): at once, or into the command list
+   with size bytes at cmd->data copied alongside */
+static void draw_now(const command_t* cmd) {
+    raster_t r = { ctx.backbuffer, ctx.stride, 0, 0, ctx.width, ctx.height, 0 };
+    command_draw(&r, cmd);
+}
+
+static void submit(command_t* cmd, int32_t x0, int32_t y0, int32_t x1, int32_t y1, uint32_t size) {
+    cmd->blend = blend_mode == GRAPHICS_BLEND_ALPHA && !capturing;
+    
+    if (capturing || panicking || !bin_first) {
+        draw_now(cmd);
+        return;
+    }
+    
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > (int32_t)ctx.width) x1 = ctx.width;
+    if (y1 > (int32_t)ctx.height) y1 = ctx.height;
+    if (x0 >= x1 || y0 >= y1) return;
+    
+    uint32_t tx0 = x0 >> GRAPHICS_TILE_SHIFT, tx1 = (x1 - 1) >> GRAPHICS_TILE_SHIFT;
+    uint32_t ty0 = y0 >> GRAPHICS_TILE_SHIFT, ty1 = (y1 - 1) >> GRAPHICS_TILE_SHIFT;
+    uint32_t entries = (tx1 - tx0 + 1) * (ty1 - ty0 + 1);
+    size = (size + 3) & ~3u;
+    
+    // A full list is drawn early; the frame just takes two batches
+    if (command_count == GRAPHICS_MAX_COMMANDS || bin_entry_count + entries > GRAPHICS_BIN_ENTRIES ||
+        payload_used + size > GRAPHICS_PAYLOAD_BYTES) {
+        graphics_flush();
+        if (command_count) {   // Refused: too late to keep the order anyway
+            draw_now(cmd);
+            return;
+        }
+    }
+    
+    uint32_t index = command_count++;
+    commands[index] = *cmd;
+    if (size) {
+        uint8_t* copy = payload + payload_used;
+        memcpy(copy, cmd->data, size);
+        commands[index].data = copy;
+        payload_used += size;
+    }
+    
+    for (uint32_t ty = ty0; ty <= ty1; ty++) {
+        for (uint32_t tx = tx0; tx <= tx1; tx++) {
+            uint32_t tile = ty * tiles_x + tx;
+            uint32_t entry = bin_entry_count++;
+            
+            bin_entries[entry].command = index;
+            bin_entries[entry].next = BIN_END;
+            if (bin_first[tile] == BIN_END) bin_first[tile] = entry;
+            else bin_entries[bin_last[tile]].next = entry;
+            bin_last[tile] = entry;
+        }
+    }
+}
+
+static void draw_box(int32_t x0, int32_t y0, int32_t x1, int32_t y1, color_t color) {
+    command_t cmd = { .op = CMD_BOX, .color = color, .x0 = x0, .y0 = y0, .x1 = x1, .y1 = y1 };
+    submit(&cmd, x0, y0, x1, y1, 0);
+}
+
+static void draw_glyph(int32_t x, int32_t y, char c, color_t color) {
+    command_t cmd = { .op = CMD_GLYPH, .glyph = c, .color = color, .x0 = x, .y0 = y };
+    submit(&cmd, x, y, x + 8, y + 8, 0);
+}
+
+void graphics_clear(color_t color) {
+    if (!ctx.initialized) return;
+    
+    if (capturing) {
+        draw_box(0, 0, ctx.width, ctx.height, color);
+        return;
+    }
+    
+    // New background: the whole frame changes
+    if (!clear_valid || color != clear_color) {
+        draw_box(0, 0, ctx.width, ctx.height, color);
+        clear_color = color;
+        clear_valid = 1;
+        full_damage = 1;
+        frame_damage.count = 0;
+        last_damage.count = 0;
+        pixels_cleared_pending += ctx.width * ctx.height;
+        return;
+    }
+    
+    // Same background: only erase what the last and current frame drew.
+    // Those boxes stay scheduled for present via last_damage.
+    for (uint32_t i = 0; i < frame_damage.count; i++) {
+        damage_list_add(&last_damage, frame_damage.rects[i]);
+    }
+    frame_damage.count = 0;
+    
+    for (uint32_t i = 0; i < last_damage.count; i++) {
+        const graphics_rect_t* r = &last_damage.rects[i];
+        draw_box(r->x0, r->y0, r->x1, r->y1, color);
+        pixels_cleared_pending += rect_area(r);
+    }
+}
+
+void graphics_put_pixel(uint32_t x, uint32_t y, color_t color) {
+    if (!ctx.initialized) return;
+    if (x >= ctx.width || y >= ctx.height) return;
+    
+    damage_add(x, y, 1, 1);
+    command_t cmd = { .op = CMD_PIXEL, .color = color, .x0 = x, .y0 = y };
+    submit(&cmd, x, y, x + 1, y + 1, 0);
+}
+
+void graphics_set_blend_mode(graphics_blend_mode_t mode) {
+    blend_mode = mode;
+}
+
+graphics_blend_mode_t graphics_get_blend_mode(void) {
+    return blend_mode;
+}
+
+static void present_region(const graphics_rect_t* r) {
+    uint32_t count = r->x1 - r->x0;
+    const uint32_t* src = ctx.backbuffer + r->y0 * ctx.stride + r->x0;
+    uint8_t* dst = (uint8_t*)ctx.framebuffer + r->y0 * ctx.pitch + r->x0 * fb_bytes_per_pixel;
+    
+    for (uint32_t y = r->y0; y < r->y1; y++) {
+        present_row(dst, src, count);
+        src += ctx.stride;
+        dst += ctx.pitch;
+    }
+}
+
+void graphics_panic(void) {
+    panicking = 1;
+}
+
+void graphics_present(void) {
+    if (!ctx.initialized || capturing) return;
+    
+    // Barrier: every tile of the frame is drawn before any of it is shown
+    graphics_flush();
+    
+    // Region that differs from the screen: this frame's and last frame's boxes
+    damage_list_t region = last_damage;
+    for (uint32_t i = 0; i < frame_damage.count; i++) {
+        damage_list_add(&region, frame_damage.rects[i]);
+    }
+    
+    frame_stats.damage_rects = full_damage ? 1 : region.count;
+    frame_stats.pixels_pushed = 0;
+    
+    if (ctx.backbuffer != ctx.framebuffer) {
+        if (full_damage || panicking) {   // Damage lists may be half-updated
+            graphics_rect_t all = { 0, 0, ctx.width, ctx.height };
+            present_region(&all);
+            frame_stats.pixels_pushed = ctx.width * ctx.height;
+        } else {
+            for (uint32_t i = 0; i < region.count; i++) {
+                present_region(&region.rects[i]);
+                frame_stats.pixels_pushed += rect_area(&region.rects[i]);
+            }
+        }
+    }
+    
+    trace_counter(TRACE_PIXELS_PUSHED, frame_stats.pixels_pushed);
+    
+    frame_stats.frames++;
+    frame_stats.pixels_cleared = pixels_cleared_pending;
+    frame_stats.commands = commands_pending;
+    frame_stats.tiles = tiles_pending;
+    pixels_cleared_pending = 0;
+    commands_pending = 0;
+    tiles_pending = 0;
+    
+    last_damage = frame_damage;
+    frame_damage.count = 0;
+    full_damage = 0;
+}
+
+const graphics_frame_stats_t* graphics_get_frame_stats(void) {
+    return &frame_stats;
+}
+
+void graphics_draw_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h, color_t color) {
+    if (!ctx.initialized) return;
+    
+    // Four edges, so a hollow frame doesn't damage its interior
+    damage_add(x, y, w, 1);
+    damage_add(x, y + h - 1, w, 1);
+    damage_add(x, y, 1, h);
+    damage_add(x + w - 1, y, 1, h);
+    
+    int32_t x0 = x, y0 = y;
+    int32_t x1 = x0 + (int32_t)w, y1 = y0 + (int32_t)h;
+    
+    // Top and bottom; corners belong to these rows so nothing is drawn twice
+    draw_box(x0, y0, x1, y0 + 1, color);
+    if (h > 1) draw_box(x0, y1 - 1, x1, y1, color);
+    
+    // Left and right, between the corners
+    draw_box(x0, y0 + 1, x0 + 1, y1 - 1, color);
+    if (w > 1) draw_box(x1 - 1, y0 + 1, x1, y1 - 1, color);
+}
+
+void graphics_fill_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h, color_t color) {
+    if (!ctx.initialized) return;
+    
+    damage_add(x, y, w, h);
+    draw_box(x, y, (int32_t)x + (int32_t)w, (int32_t)y + (int32_t)h, color);
+}
+
+void graphics_draw_circle(uint32_t cx, uint32_t cy, uint32_t radius, color_t color) {
+    if (!ctx.initialized) return;
+    
+    int32_t r = radius;
+    damage_add((int32_t)cx - r, (int32_t)cy - r, 2 * r + 1, 2 * r + 1);
+    
+    command_t cmd = { .op = CMD_CIRCLE, .color = color, .x0 = cx, .y0 = cy, .radius = r };
+    submit(&cmd, (int32_t)cx - r, (int32_t)cy - r, (int32_t)cx + r + 1, (int32_t)cy + r + 1, 0);
+}
+
+void graphics_fill_circle(uint32_t cx, uint32_t cy, uint32_t radius, color_t color) {
+    if (!ctx.initialized) return;
+    
+    int32_t r = radius;
+    damage_add((int32_t)cx - r, (int32_t)cy - r, 2 * r + 1, 2 * r + 1);
+    
+    command_t cmd = { .op = CMD_FILL_CIRCLE, .color = color, .x0 = cx, .y0 = cy, .radius = r };
+    submit(&cmd, (int32_t)cx - r, (int32_t)cy - r, (int32_t)cx + r + 1, (int32_t)cy + r + 1, 0);
+}
+
+void graphics_draw_line(uint32_t x1, uint32_t y1, uint32_t x2, uint32_t y2, color_t color) {
+    if (!ctx.initialized) return;
+    
+    int32_t left = x1 < x2 ? x1 : x2, right = x1 < x2 ? x2 : x1;
+    int32_t top = y1 < y2 ? y1 : y2, bottom = y1 < y2 ? y2 : y1;
+    damage_add(left, top, right - left + 1, bottom - top + 1);
+    
+    command_t cmd = { .op = CMD_LINE, .color = color, .x0 = x1, .y0 = y1, .x1 = x2, .y1 = y2 };
+    submit(&cmd, left, top, right + 1, bottom + 1, 0);
+}
+
+void graphics_draw_char(uint32_t x, uint32_t y, char c, color_t color) {
+    if (!ctx.initialized) return;
+    
+    damage_add(x, y, 8, 8);
+    draw_glyph(x, y, c, color);
+}
+
 void graphics_draw_string(uint32_t x, uint32_t y, const char* str, color_t color) {
     if (!ctx.initialized) return;
     
     uint32_t cx = x;
     while (*str) {
         if (*str == '\n') {
+            damage_add(x, y, cx - x, 8);
             cx = x;
             y += 10;
         } else {
-            graphics_draw_char(cx, y, *str, color);
+            draw_glyph(cx, y, *str, color);
             cx += 8;
         }
         str++;
     }
+    damage_add(x, y, cx - x, 8);
+}
+
+/* Text runs
+   A single line rasterised once into per-row pixel masks. Drawing walks
+   each mask row as whole spans, merging glyphs that touch. */
+void graphics_text_run_init(graphics_text_run_t* run, uint32_t x, uint32_t y, const char* str) {
+    run->x = x;
+    run->y = y;
+    run->length = 0;
+    for (int row = 0; row < 8; row++) {
+        for (int w = 0; w < GRAPHICS_TEXT_RUN_WORDS; w++) {
+            run->rows[row][w] = 0;
+        }
+    }
+    if (!atlas_ready) build_glyph_atlas();
+    
+    while (str[run->length] && str[run->length] != '\n' && run->length < GRAPHICS_TEXT_RUN_MAX) {
+        const glyph_t* glyph = glyph_for(str[run->length]);
+        uint32_t bit = run->length * 8;
+        for (int row = 0; row < 8; row++) {
+            // Glyph columns are byte aligned inside the word
+            run->rows[row][bit / 32] |= (uint32_t)glyph->mask[row] << (bit % 32);
+        }
+        run->length++;
+    }
+}
+
+void graphics_text_run_init_centered(graphics_text_run_t* run, uint32_t y, const char* str) {
+    graphics_text_run_init(run, 0, y, str);
+    run->x = ((int32_t)ctx.width - (int32_t)(run->length * 8)) / 2;
+}
+
+void graphics_text_run_draw(const graphics_text_run_t* run, color_t color) {
+    if (!ctx.initialized) return;
+    if (run->length == 0) return;
+    
+    damage_add(run->x, run->y, run->length * 8, 8);
+    
+    command_t cmd = { .op = CMD_TEXT_RUN, .color = color, .data = run };
+    submit(&cmd, run->x, run->y, run->x + run->length * 8, run->y + 8, sizeof(*run));
 }
 
 void graphics_draw_string_centered(uint32_t y, const char* str, color_t color) {
     if (!ctx.initialized) return;
     
-    // Calculate string width
-    uint32_t len = 0;
+    // Rasterising measures the string too, so it is walked only once
+    graphics_text_run_t run;
+    graphics_text_run_init_centered(&run, y, str);
+    
+    if (str[run.length] == 0) {
+        graphics_text_run_draw(&run, color);
+        return;
+    }
+    
+    // Longer or multi-line text: glyph by glyph
+    uint32_t len = run.length;
     while (str[len]) len++;
+    graphics_draw_string((ctx.width - len * 8) / 2, y, str, color);
+}
+
+/* Off-screen surfaces: the context is pointed at the surface and the
+   back buffer geometry is parked in screen until drawing comes back */
+void graphics_set_target(const graphics_surface_t* surface) {
+    if (!ctx.initialized) return;
+    
+    if (!capturing) screen = ctx;
     
-    uint32_t x = (ctx.width - len * 8) / 2;
-    graphics_draw_string(x, y, str, color);
+    if (!surface) {
+        ctx = screen;
+        capturing = 0;
+        return;
+    }
+    
+    ctx.backbuffer = surface->pixels;
+    ctx.width = surface->width;
+    ctx.height = surface->height;
+    ctx.stride = surface->stride;
+    capturing = 1;
 }
 
-color_t graphics_blend_color(color_t c1, color_t c2, float t) {
-    if (t < 0.0f) t = 0.0f;
-    if (t > 1.0f) t = 1.0f;
+static uint32_t sprite_color_index(graphics_sprite_t* sprite, color_t color) {
+    for (uint32_t i = 0; i < sprite->color_count; i++) {
+        if (sprite->palette[i] == color) return i;
+    }
+    if (sprite->color_count == GRAPHICS_SPRITE_COLORS) return GRAPHICS_SPRITE_COLORS;
     
-    uint8_t a1 = (c1 >> 24) & 0xFF;
-    uint8_t r1 = (c1 >> 16) & 0xFF;
-    uint8_t g1 = (c1 >> 8) & 0xFF;
-    uint8_t b1 = c1 & 0xFF;
+    sprite->palette[sprite->color_count] = color;
+    return sprite->color_count++;
+}
+
+uint8_t graphics_sprite_encode(graphics_sprite_t* sprite, const graphics_surface_t* surface,
+                               int32_t origin_x, int32_t origin_y,
+                               graphics_span_t* spans, uint32_t max_spans) {
+    uint32_t count = 0;
     
-    uint8_t a2 = (c2 >> 24) & 0xFF;
-    uint8_t r2 = (c2 >> 16) & 0xFF;
-    uint8_t g2 = (c2 >> 8) & 0xFF;
-    uint8_t b2 = c2 & 0xFF;
+    sprite->spans = spans;
+    sprite->span_count = 0;
+    sprite->color_count = 0;
+    sprite->x0 = sprite->y0 = 0;
+    sprite->x1 = sprite->y1 = 0;
     
-    uint8_t a = a1 + (uint8_t)((a2 - a1) * t);
-    uint8_t r = r1 + (uint8_t)((r2 - r1) * t);
-    uint8_t g = g1 + (uint8_t)((g2 - g1) * t);
-    uint8_t b = b1 + (uint8_t)((b2 - b1) * t);
+    const uint32_t* row = surface->pixels;
+    for (uint32_t y = 0; y < surface->height; y++, row += surface->stride) {
+        uint32_t x = 0;
+        
+        while (x < surface->width) {
+            color_t color = row[x];
+            if ((color >> 24) == 0) {
+                x++;
+                continue;
+            }
+            
+            uint32_t start = x;
+            while (x < surface->width && row[x] == color && x - start < 0xFFFF) x++;
+            
+            uint32_t index = sprite_color_index(sprite, color);
+            if (index == GRAPHICS_SPRITE_COLORS || count == max_spans) return 0;
+            
+            graphics_span_t* s = &spans[count];
+            s->x = (int32_t)start - origin_x;
+            s->y = (int32_t)y - origin_y;
+            s->length = x - start;
+            s->color = index;
+            
+            // Bounds, for damage when the sprite is drawn
+            int32_t x1 = s->x + s->length;
+            if (count == 0) {
+                sprite->x0 = s->x;
+                sprite->y0 = s->y;
+                sprite->x1 = x1;
+            }
+            if (s->x < sprite->x0) sprite->x0 = s->x;
+            if (x1 > sprite->x1) sprite->x1 = x1;
+            sprite->y1 = s->y + 1;
+            count++;
+        }
+    }
+    
+    sprite->span_count = count;
+    return 1;
+}
+
+void graphics_sprite_draw(const graphics_sprite_t* sprite, int32_t x, int32_t y) {
+    if (!ctx.initialized) return;
+    
+    damage_add(x + sprite->x0, y + sprite->y0, sprite->x1 - sprite->x0, sprite->y1 - sprite->y0);
+    
+    command_t cmd = { .op = CMD_SPRITE, .x0 = x, .y0 = y, .data = sprite };
+    submit(&cmd, x + sprite->x0, y + sprite->y0, x + sprite->x1, y + sprite->y1, sizeof(*sprite));
+}
+
+color_t graphics_mix_color(color_t c1, color_t c2, uint32_t weight) {
+    if (weight > 256) weight = 256;
+    
+    // Per channel c1 + (c2 - c1) * weight / 256, rounding toward c1
+    int32_t w = weight;
+    int32_t a1 = (c1 >> 24) & 0xFF, a2 = (c2 >> 24) & 0xFF;
+    int32_t r1 = (c1 >> 16) & 0xFF, r2 = (c2 >> 16) & 0xFF;
+    int32_t g1 = (c1 >> 8) & 0xFF,  g2 = (c2 >> 8) & 0xFF;
+    int32_t b1 = c1 & 0xFF,         b2 = c2 & 0xFF;
+    
+    uint32_t a = a1 + (a2 - a1) * w / 256;
+    uint32_t r = r1 + (r2 - r1) * w / 256;
+    uint32_t g = g1 + (g2 - g1) * w / 256;
+    uint32_t b = b1 + (b2 - b1) * w / 256;
     
     return (a << 24) | (r << 16) | (g << 8) | b;
 }
+
+color_t graphics_blend_color(color_t c1, color_t c2, float t) {
+    if (t < 0.0f) t = 0.0f;
+    if (t > 1.0f) t = 1.0f;
+    
+    // One float conversion per call; the channels are integer math
+    return graphics_mix_color(c1, c2, (uint32_t)(t * 256.0f));
+}
@@ -1,18 +1,76 @@
 #include "../include/gui.h"
 #include "../include/graphics.h"
 #include "../include/universe.h"
+#include "../include/fixmath.h"
+#include "../include/input.h"
+#include "../include/trace.h"
+#include "../include/profile.h"
+#include "../include/hud.h"
 
 static gui_state_t current_state = GUI_STATE_WELCOME;
-static float time_elapsed = 0.0f;
+static angle_t time_phase = 0;    // Elapsed time at one radian per second, wrapping
+
+/* Static screen text, rasterised once in gui_init() */
+static graphics_text_run_t welcome_title, welcome_subtitle;
+static graphics_text_run_t welcome_prompt, welcome_hint;
+static graphics_text_run_t reg_title, reg_name, reg_level, reg_purpose;
+static graphics_text_run_t reg_info, reg_info2, reg_prompt;
+static graphics_text_run_t desk_anchor, desk_fields, desk_observer, desk_esc;
+static graphics_text_run_t desk_title, desk_hint;
+
+static void gui_build_text(void) {
+    uint32_t w = graphics_get_width();
+    uint32_t h = graphics_get_height();
+    
+    // Welcome
+    graphics_text_run_init_centered(&welcome_title, h / 4, "=== PARADOX OS ===");
+    graphics_text_run_init_centered(&welcome_subtitle, h / 4 + 30, "A Quantum-Inspired Universal Operating System");
+    graphics_text_run_init_centered(&welcome_prompt, h - 100, "You are about to enter a living system.");
+    graphics_text_run_init_centered(&welcome_hint, h - 80, "Press any key to begin observation");
+    
+    // Registration (same vertical rhythm the form always used)
+    uint32_t y = 100;
+    graphics_text_run_init_centered(&reg_title, y, "=== OBSERVER REGISTRATION ===");
+    y += 40;
+    graphics_text_run_init_centered(&reg_name, y, "Observer Name: [ANONYMOUS]");
+    y += 30;
+    graphics_text_run_init_centered(&reg_level, y, "Knowledge Level: [EXPLORER]");
+    y += 30;
+    graphics_text_run_init_centered(&reg_purpose, y, "Purpose: [OBSERVATION]");
+    y += 80;
+    graphics_text_run_init_centered(&reg_info, y, "This creates your Observer Universe.");
+    y += 20;
+    graphics_text_run_init_centered(&reg_info2, y, "Your interactions will shape system state.");
+    y += 60;
+    graphics_text_run_init_centered(&reg_prompt, y, "Press SPACE to continue");
+    
+    // Desktop status bar and header
+    y = h - 30;
+    graphics_text_run_init(&desk_anchor, 10, y + 10, "[ ANCHOR UNIVERSE ]");
+    graphics_text_run_init(&desk_fields, 200, y + 10, "Cognitive Fields: ACTIVE");
+    graphics_text_run_init(&desk_observer, 450, y + 10, "Observer: CONNECTED");
+    graphics_text_run_init(&desk_esc, w - 200, y + 10, "ESC = Return");
+    graphics_text_run_init(&desk_title, 10, 10, "ParadoxOS v0.3.0 - Observer Desktop");
+    graphics_text_run_init(&desk_hint, 10, 25, "Press ESC to return to Welcome");
+}
 
 void gui_init(void) {
     current_state = GUI_STATE_WELCOME;
-    time_elapsed = 0.0f;
+    time_phase = 0;
+    gui_build_text();
     anchor_universe_init();
 }
 
-void gui_update(float delta_time) {
-    time_elapsed += delta_time;
+void gui_update(fixed_t delta_time) {
+    trace_begin(TRACE_GUI_UPDATE, 0);
+    
+    // Keys queued by IRQ 1 since the last frame, in arrival order
+    input_event_t event;
+    while (input_poll(&event)) {
+        gui_handle_key(&event);
+    }
+    
+    time_phase += fixed_to_angle(delta_time);
     
     switch (current_state) {
         case GUI_STATE_WELCOME:
@@ -22,9 +80,12 @@ void gui_update(float delta_time) {
 default:
             break;
     }
+    trace_end(TRACE_GUI_UPDATE, 0);
 }
 
 void gui_render(void) {
+    trace_begin(TRACE_GUI_RENDER, current_state);
+    
     switch (current_state) {
         case GUI_STATE_WELCOME:
             gui_welcome_render();
@@ -38,11 +99,15 @@ void gui_render(void) {
         default:
             break;
     }
+    
+    // Show the finished frame in one pass (no partial frames on screen)
+    graphics_present();
+    trace_end(TRACE_GUI_RENDER, current_state);
 }
 
-void gui_handle_key(uint8_t scancode) {
+void gui_handle_key(const input_event_t* event) {
     // Only handle key presses (not releases)
-    if (scancode & 0x80) return;
+    if (!event->pressed) return;
     
     switch (current_state) {
         case GUI_STATE_WELCOME:
@@ -52,17 +117,23 @@ void gui_handle_key(uint8_t scancode) {
             
         case GUI_STATE_REGISTRATION:
             // Space/Enter advances to desktop
-            if (scancode == 0x1C || scancode == 0x39) { // Enter or Space
+            if (event->keycode == KEY_ENTER || event->keycode == KEY_SPACE) {
                 current_state = GUI_STATE_DESKTOP;
             }
             break;
             
         case GUI_STATE_DESKTOP:
             // ESC returns to welcome
-            if (scancode == 0x01) {
+            if (event->keycode == KEY_ESCAPE) {
                 current_state = GUI_STATE_WELCOME;
-                time_elapsed = 0.0f;
+                time_phase = 0;
                 anchor_universe_init();
+            } else if (event->keycode == KEY_F8) {
+                hud_toggle();
+            } else if (event->keycode == KEY_F9) {
+                hud_profile_toggle();
+            } else if (event->keycode == KEY_F10) {
+                profile_dump();   // Folded stacks out of COM1
             }
             break;
             
@@ -79,6 +150,12 @@ void gui_set_state(gui_state_t state) {
     current_state = state;
 }
 
+/* Prompt color pulsing between gray and white at two radians per second */
+static color_t gui_prompt_color(void) {
+    fixed_t pulse = (fixed_sin(time_phase * 2) + FIXED_ONE) / 2;
+    return graphics_mix_color(COLOR_TEXT_GRAY, COLOR_TEXT_WHITE, pulse >> (FIXED_SHIFT - 8));
+}
+
 /* Welcome Screen (Observer Birth) */
 void gui_welcome_render(void) {
     // Dark space background
@@ -86,27 +163,27 @@ void gui_welcome_render(void) {
     
     universe_t* anchor = anchor_universe_get();
     
-    // Title appears after universe forms
-    if (anchor->formation > 0.5f) {
-        uint32_t y = graphics_get_height() / 4;
+    // Title fades in while the universe finishes forming
+    if (anchor->formation > FIXED_HALF) {
+        uint32_t alpha = ((anchor->formation - FIXED_HALF) * 2 * 255) >> FIXED_SHIFT;
+        if (alpha > 255) alpha = 255;
         
-        graphics_draw_string_centered(y, "=== PARADOX OS ===", COLOR_TEXT_WHITE);
-        graphics_draw_string_centered(y + 30, "A Quantum-Inspired Universal Operating System", COLOR_TEXT_GRAY);
+        graphics_set_blend_mode(GRAPHICS_BLEND_ALPHA);
+        graphics_text_run_draw(&welcome_title, (alpha << 24) | (COLOR_TEXT_WHITE & 0x00FFFFFF));
+        graphics_text_run_draw(&welcome_subtitle, (alpha << 24) | (COLOR_TEXT_GRAY & 0x00FFFFFF));
+        graphics_set_blend_mode(GRAPHICS_BLEND_NONE);
     }
     
     // Render forming universe
     anchor_universe_render();
     
     // Prompt appears when fully formed
-    if (anchor->formation >= 1.0f) {
-        uint32_t y = graphics_get_height() - 100;
-        
+    if (anchor->formation >= FIXED_ONE) {
         // Pulsing text effect
-        float pulse = (universe_sin(time_elapsed * 2.0f) + 1.0f) * 0.5f;
-        color_t prompt_color = graphics_blend_color(COLOR_TEXT_GRAY, COLOR_TEXT_WHITE, pulse);
+        color_t prompt_color = gui_prompt_color();
         
-        graphics_draw_string_centered(y, "You are about to enter a living system.", prompt_color);
-        graphics_draw_string_centered(y + 20, "Press any key to begin observation", prompt_color);
+        graphics_text_run_draw(&welcome_prompt, prompt_color);
+        graphics_text_run_draw(&welcome_hint, prompt_color);
     }
 }
 
@@ -115,37 +192,28 @@ void gui_registration_render(void) {
     graphics_clear(COLOR_SPACE_DARK);
     
     uint32_t cx = graphics_get_width() / 2;
-    uint32_t y = 100;
     
     // Title
-    graphics_draw_string_centered(y, "=== OBSERVER REGISTRATION ===", COLOR_TEXT_WHITE);
-    y += 40;
+    graphics_text_run_draw(&reg_title, COLOR_TEXT_WHITE);
     
     // Form (simplified for now)
-    graphics_draw_string_centered(y, "Observer Name: [ANONYMOUS]", COLOR_TEXT_GRAY);
-    y += 30;
-    graphics_draw_string_centered(y, "Knowledge Level: [EXPLORER]", COLOR_TEXT_GRAY);
-    y += 30;
-    graphics_draw_string_centered(y, "Purpose: [OBSERVATION]", COLOR_TEXT_GRAY);
-    y += 80;
+    graphics_text_run_draw(&reg_name, COLOR_TEXT_GRAY);
+    graphics_text_run_draw(&reg_level, COLOR_TEXT_GRAY);
+    graphics_text_run_draw(&reg_purpose, COLOR_TEXT_GRAY);
     
     // Info text
-    graphics_draw_string_centered(y, "This creates your Observer Universe.", COLOR_UNIVERSE_BLUE);
-    y += 20;
-    graphics_draw_string_centered(y, "Your interactions will shape system state.", COLOR_UNIVERSE_BLUE);
-    y += 60;
+    graphics_text_run_draw(&reg_info, COLOR_UNIVERSE_BLUE);
+    graphics_text_run_draw(&reg_info2, COLOR_UNIVERSE_BLUE);
     
     // Prompt
-    float pulse = (universe_sin(time_elapsed * 2.0f) + 1.0f) * 0.5f;
-    color_t prompt_color = graphics_blend_color(COLOR_TEXT_GRAY, COLOR_TEXT_WHITE, pulse);
-    graphics_draw_string_centered(y, "Press SPACE to continue", prompt_color);
+    graphics_text_run_draw(&reg_prompt, gui_prompt_color());
     
     // Small decorative universe
     universe_t deco;
-    universe_init(&deco, cx, graphics_get_height() - 150, 40.0f, COLOR_FIELD_PURPLE);
-    deco.formation = 1.0f;
+    universe_init(&deco, FIXED_FROM_INT(cx), FIXED_FROM_INT(graphics_get_height() - 150), FIXED_FROM_INT(40), COLOR_FIELD_PURPLE);
+    deco.formation = FIXED_ONE;
     deco.state = UNIVERSE_STATE_PULSING;
-    deco.energy = time_elapsed;
+    deco.energy = time_phase;
     universe_render(&deco);
 }
 
@@ -160,14 +228,20 @@ void gui_desktop_render(void) {
     uint32_t y = graphics_get_height() - 30;
     graphics_fill_rect(0, y, graphics_get_width(), 30, 0xFF1a1a2e);
     
-    graphics_draw_string(10, y + 10, "[ ANCHOR UNIVERSE ]", COLOR_ENERGY_CYAN);
-    graphics_draw_string(200, y + 10, "Cognitive Fields: ACTIVE", COLOR_TEXT_GRAY);
-    graphics_draw_string(450, y + 10, "Observer: CONNECTED", COLOR_TEXT_GRAY);
+    graphics_text_run_draw(&desk_anchor, COLOR_ENERGY_CYAN);
+    graphics_text_run_draw(&desk_observer, COLOR_TEXT_GRAY);
+    
+    // The HUD's summary takes the fields slot in the bar
+    if (hud_visible()) hud_render();
+    else graphics_text_run_draw(&desk_fields, COLOR_TEXT_GRAY);
     
     // ESC hint
-    graphics_draw_string(graphics_get_width() - 200, y + 10, "ESC = Return", COLOR_TEXT_GRAY);
+    graphics_text_run_draw(&desk_esc, COLOR_TEXT_GRAY);
     
     // Top info
-    graphics_draw_string(10, 10, "ParadoxOS v0.3.0 - Observer Desktop", COLOR_TEXT_WHITE);
-    graphics_draw_string(10, 25, "Press ESC to return to Welcome", COLOR_TEXT_GRAY);
+    graphics_text_run_draw(&desk_title, COLOR_TEXT_WHITE);
+    graphics_text_run_draw(&desk_hint, COLOR_TEXT_GRAY);
+    
+    hud_profile_render();
 }
+
@@ -0,0 +1,352 @@
+#include "../include/hud.h"
+#include "../include/graphics.h"
+#include "../include/timer.h"
+#include "../include/field.h"
+#include "../include/pmm.h"
+#include "../include/idt.h"
+#include "../include/profile.h"
+
+#define HUD_LINES           7
+#define HUD_LINE_PITCH      12
+#define HUD_FIELD_ROWS      3        // Busiest fields listed
+#define HUD_FIELDS_TRACKED  64       // Fields whose share can be worked out
+#define HUD_IRQ_ROWS        4        // Busiest vectors listed
+#define HUD_IRQ_VECTORS     (IDT_STUB_VECTORS - IDT_IRQ_BASE)
+#define HUD_BAR_WIDTH       2
+#define HUD_GRAPH_HEIGHT    48       // Twice the target frame time
+#define HUD_WIDTH           328
+#define HUD_HEIGHT          (8 + HUD_LINES * HUD_LINE_PITCH + HUD_GRAPH_HEIGHT + 8)
+#define HUD_STATUS_BAR      30       // gui_desktop_render()'s bar
+#define HUD_GAP             4        // Kept clear above the bar, so damage
+                                     // tracking does not merge the two
+
+#define HUD_BACKGROUND      0xFF1a1a2e
+#define HUD_GRAPH_BACK      0xFF10102a
+#define HUD_LATE            0xFFff5555
+
+/* Profiler panel */
+#define HUD_PROFILE_ROWS     10
+#define HUD_PROFILE_REFRESH  30
+
+static uint8_t visible = 0;
+static uint32_t refresh_age = 0;
+
+/* Begin-to-begin frame times in microseconds, oldest at frame_next once full */
+static uint32_t frame_us[HUD_HISTORY];
+static uint32_t frame_next = 0;
+static uint32_t frame_count = 0;
+
+static graphics_text_run_t lines[HUD_LINES];
+static graphics_text_run_t summary;
+
+/* Counters at the last refresh, for rates */
+static uint64_t last_ns = 0;
+static uint64_t last_ticks = 0;
+static uint32_t last_frames = 0;
+static uint32_t last_irqs[HUD_IRQ_VECTORS];
+static field_usage_t last_fields[HUD_FIELDS_TRACKED];
+static uint32_t last_field_count = 0;
+
+static uint8_t profile_panel = 0;
+static uint32_t profile_age = 0;
+static profile_entry_t profile_rows[HUD_PROFILE_ROWS];
+static uint32_t profile_row_count = 0;
+static uint32_t profile_row_total = 0;
+
+static char* hud_put_str(char* p, const char* s, uint32_t max) {
+    while (*s && max--) *p++ = *s++;
+    return p;
+}
+
+static char* hud_put_dec(char* p, uint32_t value, uint32_t width) {
+    char digits[10];
+    uint32_t n = 0;
+    do {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    while (width > n) {
+        *p++ = ' ';
+        width--;
+    }
+    while (n) *p++ = digits[--n];
+    return p;
+}
+
+/* Tenths as "12.3" */
+static char* hud_put_tenths(char* p, uint32_t tenths, uint32_t width) {
+    p = hud_put_dec(p, tenths / 10, width > 2 ? width - 2 : 0);
+    *p++ = '.';
+    *p++ = '0' + tenths % 10;
+    return p;
+}
+
+static char* hud_put_hex(char* p, uint32_t value) {
+    *p++ = '0';
+    *p++ = 'x';
+    for (int shift = 28; shift >= 0; shift -= 4) {
+        *p++ = "0123456789abcdef"[(value >> shift) & 0xF];
+    }
+    return p;
+}
+
+/* Events per second times scale (no 64-bit division in the kernel) */
+static uint32_t hud_rate(uint32_t count, uint32_t window_us, uint32_t scale) {
+    if (!window_us) return 0;
+    return (uint32_t)((float)count * scale * 1000000.0f / window_us);
+}
+
+/* Parts per thousand, safe for any total */
+static uint32_t hud_permille(uint32_t part, uint32_t total) {
+    if (!total) return 0;
+    if (part >= total) return 1000;
+    return total < (1u << 22) ? part * 1000 / total : part / (total / 1000);
+}
+
+static void hud_snapshot(void) {
+    last_ns = timer_now_ns();
+    last_ticks = timer_ticks();
+    last_frames = timer_get_frame_stats()->frames;
+    for (uint32_t v = 0; v < HUD_IRQ_VECTORS; v++) last_irqs[v] = interrupt_count(IDT_IRQ_BASE + v);
+    last_field_count = field_usage(last_fields, HUD_FIELDS_TRACKED);
+}
+
+void hud_toggle(void) {
+    visible = !visible;
+    if (!visible) return;
+    
+    // Fresh history, and rates from now; the text is built next frame
+    frame_next = 0;
+    frame_count = 0;
+    refresh_age = HUD_REFRESH_FRAMES - 1;
+    hud_snapshot();
+}
+
+uint8_t hud_visible(void) {
+    return visible;
+}
+
+/* Percentiles of the history, in tenths of a millisecond */
+static void hud_percentiles(uint32_t* p50, uint32_t* p95, uint32_t* p99) {
+    uint32_t sorted[HUD_HISTORY];
+    for (uint32_t i = 0; i < frame_count; i++) {
+        uint32_t value = frame_us[i];
+        uint32_t j = i;
+        while (j && sorted[j - 1] > value) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = value;
+    }
+    uint32_t last = frame_count - 1;
+    *p50 = sorted[last * 50 / 100] / 100;
+    *p95 = sorted[last * 95 / 100] / 100;
+    *p99 = sorted[last * 99 / 100] / 100;
+}
+
+/* Rebuild the text from counters sampled now */
+static void hud_refresh(void) {
+    static field_usage_t fields[HUD_FIELDS_TRACKED];
+    const timer_frame_stats_t* timing = timer_get_frame_stats();
+    const graphics_frame_stats_t* drawing = graphics_get_frame_stats();
+    
+    uint64_t window_ns = timer_now_ns() - last_ns;
+    uint32_t window_us = window_ns >= 0xFFFFFFFFull ? 0xFFFFFFFFu / 1000 : (uint32_t)window_ns / 1000;
+    uint32_t window_ticks = (uint32_t)(timer_ticks() - last_ticks);
+    uint32_t frames = timing->frames - last_frames;
+    
+    uint32_t x = graphics_get_width() - HUD_WIDTH - 10 + 8;
+    uint32_t y = graphics_get_height() - HUD_STATUS_BAR - HUD_GAP - HUD_HEIGHT + 8;
+    char text[GRAPHICS_TEXT_RUN_MAX + 1];
+    char* p;
+    
+    // Frame times
+    uint32_t p50 = 0, p95 = 0, p99 = 0;
+    if (frame_count) hud_percentiles(&p50, &p95, &p99);
+    p = hud_put_str(text, "FRAME ms  p50 ", 16);
+    p = hud_put_tenths(p, p50, 4);
+    p = hud_put_str(p, "  p95 ", 8);
+    p = hud_put_tenths(p, p95, 4);
+    p = hud_put_str(p, "  p99 ", 8);
+    p = hud_put_tenths(p, p99, 4);
+    *p = 0;
+    graphics_text_run_init(&lines[0], x, y, text);
+    
+    uint32_t fps = hud_rate(frames, window_us, 10);
+    p = hud_put_str(text, "FPS ", 8);
+    p = hud_put_tenths(p, fps, 0);
+    p = hud_put_str(p, "  work ", 8);
+    p = hud_put_tenths(p, timing->work_ns / 100000, 0);
+    p = hud_put_str(p, " ms  pushed ", 16);
+    p = hud_put_dec(p, drawing->pixels_pushed, 0);
+    p = hud_put_str(p, " px", 4);
+    *p = 0;
+    graphics_text_run_init(&lines[1], x, y + HUD_LINE_PITCH, text);
+    
+    // Busiest IRQ vectors over the window
+    uint32_t deltas[HUD_IRQ_VECTORS];
+    for (uint32_t v = 0; v < HUD_IRQ_VECTORS; v++) {
+        uint32_t count = interrupt_count(IDT_IRQ_BASE + v);
+        deltas[v] = count - last_irqs[v];
+        last_irqs[v] = count;
+    }
+    p = hud_put_str(text, "IRQ/s", 8);
+    for (uint32_t row = 0; row < HUD_IRQ_ROWS; row++) {
+        uint32_t best = 0;
+        for (uint32_t v = 1; v < HUD_IRQ_VECTORS; v++) {
+            if (deltas[v] > deltas[best]) best = v;
+        }
+        if (!deltas[best]) break;
+        *p++ = ' ';
+        p = hud_put_dec(p, IDT_IRQ_BASE + best, 0);
+        *p++ = ':';
+        p = hud_put_dec(p, hud_rate(deltas[best], window_us, 1), 0);
+        deltas[best] = 0;
+    }
+    *p = 0;
+    graphics_text_run_init(&lines[2], x, y + 2 * HUD_LINE_PITCH, text);
+    
+    p = hud_put_str(text, "FIELDS ", 8);
+    p = hud_put_dec(p, field_live_count(), 0);
+    p = hud_put_str(p, "  FREE ", 8);
+    p = hud_put_dec(p, pmm_free_page_count() >> (20 - PMM_PAGE_SHIFT), 0);
+    p = hud_put_str(p, " MB", 4);
+    *p = 0;
+    graphics_text_run_init(&lines[3], x, y + 3 * HUD_LINE_PITCH, text);
+    
+    // Share of one CPU per field: ticks run against ticks elapsed
+    uint32_t field_count = field_usage(fields, HUD_FIELDS_TRACKED);
+    uint32_t shares[HUD_FIELDS_TRACKED];
+    for (uint32_t i = 0; i < field_count; i++) {
+        uint32_t before = 0;
+        for (uint32_t j = 0; j < last_field_count; j++) {
+            if (last_fields[j].id == fields[i].id) {
+                before = last_fields[j].run_ticks;
+                break;
+            }
+        }
+        shares[i] = hud_permille(fields[i].run_ticks - before, window_ticks);
+    }
+    for (uint32_t row = 0; row < HUD_FIELD_ROWS; row++) {
+        uint32_t best = field_count;
+        for (uint32_t i = 0; i < field_count; i++) {
+            if (shares[i] != 0xFFFFFFFFu && (best == field_count || shares[i] > shares[best])) best = i;
+        }
+        text[0] = 0;
+        if (best < field_count) {
+            p = hud_put_tenths(text, shares[best], 5);
+            p = hud_put_str(p, "%  ", 4);
+            p = hud_put_str(p, fields[best].name, 32);
+            *p = 0;
+            shares[best] = 0xFFFFFFFFu;
+        }
+        graphics_text_run_init(&lines[4 + row], x, y + (4 + row) * HUD_LINE_PITCH, text);
+    }
+    for (uint32_t i = 0; i < field_count; i++) last_fields[i] = fields[i];
+    last_field_count = field_count;
+    
+    // Status bar summary
+    p = hud_put_tenths(text, fps, 0);
+    p = hud_put_str(p, " FPS  p95 ", 16);
+    p = hud_put_tenths(p, p95, 0);
+    p = hud_put_str(p, " ms  ", 8);
+    p = hud_put_dec(p, field_live_count(), 0);
+    p = hud_put_str(p, " fields", 8);
+    *p = 0;
+    graphics_text_run_init(&summary, 200, graphics_get_height() - HUD_STATUS_BAR + 10, text);
+    
+    last_ns += window_ns;
+    last_ticks += window_ticks;
+    last_frames = timing->frames;
+}
+
+void hud_render(void) {
+    if (!visible) return;
+    
+    const timer_frame_stats_t* timing = timer_get_frame_stats();
+    frame_us[frame_next] = timing->last_ns / 1000;
+    frame_next = (frame_next + 1) % HUD_HISTORY;
+    if (frame_count < HUD_HISTORY) frame_count++;
+    
+    if (++refresh_age >= HUD_REFRESH_FRAMES) {
+        refresh_age = 0;
+        hud_refresh();
+    }
+    
+    uint32_t x = graphics_get_width() - HUD_WIDTH - 10;
+    uint32_t y = graphics_get_height() - HUD_STATUS_BAR - HUD_GAP - HUD_HEIGHT;
+    graphics_fill_rect(x, y, HUD_WIDTH, HUD_HEIGHT, HUD_BACKGROUND);
+    graphics_text_run_draw(&summary, COLOR_ENERGY_CYAN);
+    for (uint32_t i = 0; i < HUD_LINES; i++) {
+        graphics_text_run_draw(&lines[i], i < 4 ? COLOR_TEXT_WHITE : COLOR_TEXT_GRAY);
+    }
+    
+    // Frame-time graph, newest on the right; the middle line is the target
+    uint32_t gx = x + 8;
+    uint32_t gy = y + 8 + HUD_LINES * HUD_LINE_PITCH;
+    uint32_t target_us = timing->target_ns / 1000;
+    if (!target_us) target_us = 1;
+    graphics_fill_rect(gx, gy, HUD_HISTORY * HUD_BAR_WIDTH, HUD_GRAPH_HEIGHT, HUD_GRAPH_BACK);
+    
+    uint32_t slot = frame_count < HUD_HISTORY ? 0 : frame_next;
+    uint32_t bx = gx + (HUD_HISTORY - frame_count) * HUD_BAR_WIDTH;
+    for (uint32_t i = 0; i < frame_count; i++) {
+        uint32_t us = frame_us[slot];
+        slot = (slot + 1) % HUD_HISTORY;
+        
+        uint32_t height = us >= 2 * target_us ? HUD_GRAPH_HEIGHT : us * HUD_GRAPH_HEIGHT / (2 * target_us);
+        if (!height) height = 1;
+        color_t color = us > target_us + target_us / 10 ? HUD_LATE : COLOR_ENERGY_CYAN;
+        graphics_fill_rect(bx, gy + HUD_GRAPH_HEIGHT - height, HUD_BAR_WIDTH, height, color);
+        bx += HUD_BAR_WIDTH;
+    }
+    graphics_fill_rect(gx, gy + HUD_GRAPH_HEIGHT / 2, HUD_HISTORY * HUD_BAR_WIDTH, 1, COLOR_TEXT_GRAY);
+}
+
+void hud_profile_toggle(void) {
+    profile_panel = !profile_panel;
+    if (profile_panel) {
+        profile_reset();
+        profile_start();
+        profile_row_count = 0;
+        profile_age = HUD_PROFILE_REFRESH;
+    } else {
+        profile_stop();
+    }
+}
+
+uint8_t hud_profile_visible(void) {
+    return profile_panel;
+}
+
+/* Top right: share of samples and function */
+void hud_profile_render(void) {
+    if (!profile_panel) return;
+    
+    if (++profile_age >= HUD_PROFILE_REFRESH) {
+        profile_age = 0;
+        profile_row_count = profile_top(profile_rows, HUD_PROFILE_ROWS);
+        profile_row_total = profile_sample_count();
+    }
+    
+    uint32_t w = 300;
+    uint32_t x = graphics_get_width() - w - 10;
+    uint32_t y = 45;
+    graphics_fill_rect(x, y, w, 30 + HUD_PROFILE_ROWS * 12, HUD_BACKGROUND);
+    
+    char line[48];
+    char* p = hud_put_str(line, "PROFILE ", 16);
+    p = hud_put_dec(p, profile_row_total, 0);
+    p = hud_put_str(p, " samples  F10 = dump", 24);
+    *p = 0;
+    graphics_draw_string(x + 8, y + 8, line, COLOR_ENERGY_CYAN);
+    
+    for (uint32_t i = 0; i < profile_row_count; i++) {
+        const profile_entry_t* row = &profile_rows[i];
+        p = hud_put_tenths(line, hud_permille(row->samples, profile_row_total), 5);
+        p = hud_put_str(p, "%  ", 3);
+        p = row->name ? hud_put_str(p, row->name, 28) : hud_put_hex(p, row->addr);
+        *p = 0;
+        graphics_draw_string(x + 8, y + 24 + i * 12, line, COLOR_TEXT_GRAY);
+    }
+}
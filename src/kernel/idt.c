@@ -1,15 +1,36 @@
 #include "../include/idt.h"
-#include <string.h>
+#include "../include/io.h"
+#include "../include/pic.h"
+#include "../include/apic.h"
+#include "../include/trace.h"
+#include "../include/mem.h"
 
 extern void idt_flush(uint32_t);
+extern const uint32_t interrupt_stubs[IDT_STUB_VECTORS];   // interrupts.S
+extern void interrupt_spurious_stub();
 
 idt_entry_t idt_entries[256];
 idt_ptr_t   idt_ptr;
 
+static interrupt_handler_t handlers[256];
+static volatile uint32_t counts[256];
+static volatile uint32_t spurious_count = 0;
+
+static const char* exception_names[IDT_EXCEPTIONS] = {
+    "Divide error", "Debug", "NMI", "Breakpoint",
+    "Overflow", "Bound range", "Invalid opcode", "No FPU",
+    "Double fault", "FPU segment overrun", "Invalid TSS", "Segment not present",
+    "Stack fault", "General protection", "Page fault", "Reserved",
+    "x87 FPU error", "Alignment check", "Machine check", "SIMD FP exception",
+    "Virtualization", "Control protection", "Reserved", "Reserved",
+    "Reserved", "Reserved", "Reserved", "Reserved",
+    "Hypervisor injection", "VMM communication", "Security", "Reserved"
+};
+
 void idt_set_gate(uint8_t num, uint32_t base, uint16_t sel, uint8_t flags) {
     idt_entries[num].base_lo = base & 0xFFFF;
     idt_entries[num].base_hi = (base >> 16) & 0xFFFF;
-
+    
     idt_entries[num].sel     = sel;
     idt_entries[num].always0 = 0;
     // We must uncomment the OR below when we get to using user-mode.
@@ -20,18 +41,98 @@ void idt_set_gate(uint8_t num, uint32_t base, uint16_t sel, uint8_t flags) {
 void init_idt() {
     idt_ptr.limit = sizeof(idt_entry_t) * 256 - 1;
     idt_ptr.base  = (uint32_t)&idt_entries;
-
+    
     // Zero out the IDT
-    for(int i = 0; i < 256; i++) {
-        idt_entries[i].base_lo = 0;
-        idt_entries[i].base_hi = 0;
-        idt_entries[i].sel = 0;
-        idt_entries[i].always0 = 0;
-        idt_entries[i].flags = 0;
+    memset(idt_entries, 0, sizeof(idt_entries));
+    
+    // Present, ring 0, 32-bit interrupt gates in the kernel code segment
+    for (int i = 0; i < IDT_STUB_VECTORS; i++) {
+        idt_set_gate(i, interrupt_stubs[i], 0x08, 0x8E);
     }
-
-    // Add ISR calls here (we will define them in assembly)
-    // For now, we'll just initialize the pointer
+    idt_set_gate(IDT_SPURIOUS_VECTOR, (uint32_t)interrupt_spurious_stub, 0x08, 0x8E);
     
     idt_flush((uint32_t)&idt_ptr);
 }
+
+void idt_load(void) {
+    idt_flush((uint32_t)&idt_ptr);
+}
+
+void interrupt_register(uint8_t vector, interrupt_handler_t handler) {
+    uint32_t flags = irq_save();
+    handlers[vector] = handler;
+    irq_restore(flags);
+}
+
+void irq_register(uint8_t irq, interrupt_handler_t handler) {
+    if (irq < IDT_IRQS) interrupt_register(IDT_IRQ_BASE + irq, handler);
+}
+
+void irq_mask(uint8_t irq) {
+    if (apic_enabled()) apic_irq_mask(irq);
+    else pic_mask(irq);
+}
+
+void irq_unmask(uint8_t irq) {
+    if (apic_enabled()) apic_irq_unmask(irq);
+    else pic_unmask(irq);
+}
+
+uint32_t interrupt_count(uint8_t vector) {
+    return counts[vector];
+}
+
+uint32_t interrupt_spurious_count(void) {
+    return spurious_count;
+}
+
+const char* interrupt_exception_name(uint8_t vector) {
+    return vector < IDT_EXCEPTIONS ? exception_names[vector] : "Interrupt";
+}
+
+void isr_handler(registers_t* regs) {
+    uint8_t vector = regs->int_no;
+    __atomic_fetch_add(&counts[vector], 1, __ATOMIC_RELAXED);
+    
+    if (handlers[vector]) {
+        handlers[vector](regs);
+        return;
+    }
+    
+    // Returning would only fault again
+    for (;;) {
+        cli();
+        hlt();
+    }
+}
+
+void irq_handler(registers_t* regs) {
+    uint8_t vector = regs->int_no;
+    uint8_t irq = vector - IDT_IRQ_BASE;
+    
+    // The APIC's spurious vector takes no EOI
+    if (vector == IDT_SPURIOUS_VECTOR) {
+        __atomic_fetch_add(&spurious_count, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    
+    // Send EOI first: the timer may switch to another field's stack and
+    // not come back through here for a while
+    if (apic_enabled()) {
+        apic_eoi();
+    } else {
+        // IRQ 7/15 with no bit in service was withdrawn before it was
+        // acknowledged. No EOI for it, but the master did see the cascade.
+        if ((irq == 7 || irq == 15) && !(pic_in_service() & (1 << irq))) {
+            if (irq == 15) pic_send_eoi(2);
+            __atomic_fetch_add(&spurious_count, 1, __ATOMIC_RELAXED);
+            return;
+        }
+        pic_send_eoi(irq);
+    }
+    __atomic_fetch_add(&counts[vector], 1, __ATOMIC_RELAXED);
+    
+    trace_begin(TRACE_IRQ, vector);
+    if (handlers[vector]) handlers[vector](regs);
+    trace_end(TRACE_IRQ, vector);
+}
@@ -0,0 +1,60 @@
+#include "../include/input.h"
+#include "../include/timer.h"
+
+/* Single-producer, single-consumer ring of raw scancodes
+   IRQ 1 only ever advances head and the main loop only ever advances
+   tail, so neither side needs a lock. Indices run free and are masked on
+   access; head - tail is the fill level. */
+#define INPUT_RING_SIZE  128   // Power of two
+
+typedef struct {
+    uint64_t time_ns;
+    uint8_t scancode;
+} input_raw_t;
+
+static input_raw_t ring[INPUT_RING_SIZE];
+static volatile uint32_t ring_head = 0;   // Next slot to write (IRQ 1)
+static volatile uint32_t ring_tail = 0;   // Next slot to read (main loop)
+static volatile uint32_t ring_dropped = 0;
+
+/* Order the slot access against the index update. x86 keeps stores in
+   order, so only the compiler has to be held back. */
+#define ring_barrier() asm volatile ("" : : : "memory")
+
+void input_push_scancode(uint8_t scancode) {
+    uint32_t head = ring_head;
+    
+    if (head - ring_tail == INPUT_RING_SIZE) {
+        ring_dropped++;
+        return;
+    }
+    
+    input_raw_t* slot = &ring[head & (INPUT_RING_SIZE - 1)];
+    slot->time_ns = timer_now_ns();
+    slot->scancode = scancode;
+    
+    ring_barrier();
+    ring_head = head + 1;
+}
+
+uint8_t input_poll(input_event_t* event) {
+    // Prefix bytes are consumed without producing an event
+    while (ring_tail != ring_head) {
+        uint32_t tail = ring_tail;
+        ring_barrier();
+        
+        input_raw_t raw = ring[tail & (INPUT_RING_SIZE - 1)];
+        ring_barrier();
+        ring_tail = tail + 1;
+        
+        if (keyboard_translate(raw.scancode, event)) {
+            event->time_ns = raw.time_ns;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+uint32_t input_dropped(void) {
+    return ring_dropped;
+}
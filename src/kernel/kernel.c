@@ -1,12 +1,25 @@
 #include <stdint.h>
 #include <stddef.h>
 #include "../include/field.h"
+#include "../include/cpu.h"
+#include "../include/mem.h"
 #include "../include/gdt.h"
 #include "../include/idt.h"
 #include "../include/io.h"
+#include "../include/pic.h"
+#include "../include/apic.h"
+#include "../include/smp.h"
+#include "../include/timer.h"
 #include "../include/multiboot.h"
+#include "../include/pmm.h"
+#include "../include/slab.h"
+#include "../include/paging.h"
 #include "../include/graphics.h"
 #include "../include/gui.h"
+#include "../include/input.h"
+#include "../include/serial.h"
+#include "../include/trace.h"
+#include "../include/profile.h"
 
 /* Hardware text mode color constants (for text mode fallback) */
 enum vga_color {
@@ -23,13 +36,6 @@ size_t terminal_column;
 uint8_t terminal_color;
 uint16_t* terminal_buffer;
 
-typedef struct registers {
-    uint32_t ds;                  
-    uint32_t edi, esi, ebp, esp, ebx, edx, ecx, eax; 
-    uint32_t int_no, err_code;    
-    uint32_t eip, cs, eflags, useresp, ss; 
-} registers_t;
-
 static inline uint8_t vga_entry_color(enum vga_color fg, enum vga_color bg) {
     return fg | bg << 4;
 }
@@ -71,31 +77,101 @@ void terminal_writestring(const char* data) {
         terminal_putchar(data[i]);
 }
 
-extern void isr0();
-extern void irq1();
+/* Append str to a report line of up to 80 characters */
+static void report_append(char* line, uint32_t* length, const char* str) {
+    while (*str && *length < 80) line[(*length)++] = *str++;
+    line[*length] = 0;
+}
+
+static void report_hex(char* line, uint32_t* length, uint32_t value) {
+    char digits[9];
+    for (int i = 0; i < 8; i++) digits[i] = "0123456789ABCDEF"[(value >> (28 - i * 4)) & 0xF];
+    digits[8] = 0;
+    report_append(line, length, digits);
+}
 
-void isr_handler(registers_t regs) {
-    terminal_writestring("[ OBSERVER ] Exception!\n");
+static void __attribute__((noreturn)) halt_forever(void) {
+    for (;;) {
+        cli();
+        hlt();
+    }
 }
 
-extern void gui_handle_key(uint8_t scancode);
+/* Set by the first CPU to fault; it alone draws the report */
+static volatile uint8_t exception_claimed = 0;
 
-void irq_handler(registers_t regs) {
-    if (regs.int_no == 33) {
-        // Read scancode
-        uint8_t scancode = inb(0x60);
-        
-        // Pass to GUI if graphics mode is active
-        if (graphics_is_available()) {
-            gui_handle_key(scancode);
+/* Fault report over whatever was on screen: the GUI in graphics mode, the
+   VGA text screen otherwise. The CPU stays halted afterwards. Any other
+   CPU that gets here, through its own fault or the NMI that stops it,
+   halts at once. The report is drawn on the faulting CPU alone, since
+   the others may have stopped anywhere, in the middle of a flush too. */
+static void exception_screen(registers_t* regs) {
+    if (__atomic_exchange_n(&exception_claimed, 1, __ATOMIC_ACQ_REL)) halt_forever();
+    smp_stop_others();
+    
+    uint32_t cr2;
+    asm volatile ("movl %%cr2, %0" : "=r"(cr2));
+    
+    // Ring 0 faults push no ESP; the interrupted one is above the CPU frame
+    const char* names[12] = { "EIP ", "CS  ", "EFL ", "ERR ", "CR2 ", "ESP ",
+                              "EAX ", "EBX ", "ECX ", "EDX ", "ESI ", "EDI " };
+    uint32_t values[12] = { regs->eip, regs->cs, regs->eflags, regs->err_code, cr2, regs->esp + 20,
+                            regs->eax, regs->ebx, regs->ecx, regs->edx, regs->esi, regs->edi };
+    
+    char lines[5][81];
+    uint32_t lengths[5] = { 0 };
+    report_append(lines[0], &lengths[0], "[ OBSERVER ] Exception ");
+    report_hex(lines[0], &lengths[0], regs->int_no);
+    report_append(lines[0], &lengths[0], ": ");
+    report_append(lines[0], &lengths[0], interrupt_exception_name(regs->int_no));
+    for (int i = 0; i < 12; i++) {
+        char* line = lines[1 + i / 3];
+        uint32_t* length = &lengths[1 + i / 3];
+        if (i % 3 == 0) line[0] = 0;
+        report_append(line, length, names[i]);
+        report_hex(line, length, values[i]);
+        report_append(line, length, "   ");
+    }
+    
+    if (graphics_is_available()) {
+        graphics_panic();
+        graphics_set_target(0);
+        graphics_fill_rect(0, 0, graphics_get_width(), graphics_get_height(), COLOR_SPACE_DEEP);
+        for (int i = 0; i < 5; i++) {
+            graphics_draw_string(16, 16 + i * 16, lines[i], i ? COLOR_TEXT_GRAY : COLOR_TEXT_WHITE);
+        }
+        graphics_present();
+    } else {
+        terminal_initialize();
+        for (int i = 0; i < 5; i++) {
+            terminal_writestring(lines[i]);
+            terminal_putchar('\n');
         }
-        
-        // Send EOI
-        outb(0x20, 0x20);
     }
+    halt_forever();
 }
 
-extern void pic_remap(int offset1, int offset2);
+static void timer_irq(registers_t* regs) {
+    (void)regs;
+    timer_tick();
+    field_timer_tick();
+}
+
+static void keyboard_irq_handler(registers_t* regs) {
+    (void)regs;
+    keyboard_irq();   // Queue the scancode; the GUI reads it on its next frame
+}
+
+/* Exceptions report and halt; drivers hook their IRQ lines. The 8259s
+   are remapped either way so a stray legacy interrupt lands on 32-47. */
+static void install_interrupts(void) {
+    init_idt();
+    pic_remap(PIC_IRQ_BASE, PIC_IRQ_BASE + 8);
+    apic_init();
+    for (int i = 0; i < IDT_EXCEPTIONS; i++) interrupt_register(i, exception_screen);
+    irq_register(1, keyboard_irq_handler);
+    irq_unmask(1);
+}
 
 /* Dummy "Tasks" (Field Excitations) - for compatibility */
 void task_kernel_monitor(void) {
@@ -108,8 +184,17 @@ void task_memory_dream(void) {
 
 /* Main Entry Point */
 void kernel_main(uint32_t magic, multiboot_info_t* mbi) {
+    cpu_detect();
+    mem_init();
+    
+    // Memory first: the back buffer, fields and caches come from it. The
+    // framebuffer is mapped write-combining before anything is drawn.
+    pmm_init(magic == 0x2BADB002 ? mbi : 0);
+    slab_init();
+    paging_init(magic == 0x2BADB002 ? mbi : 0);
+    
     /* Graphics Mode Detection */
-    if (magic == 0x2BADB002 && (mbi->flags & (1 << 12))) {
+    if (magic == 0x2BADB002 && (mbi->flags & MULTIBOOT_INFO_FRAMEBUFFER)) {
         // High-Resolution Graphics (Multiboot)
          graphics_init((uint32_t)mbi->framebuffer_addr,
                      mbi->framebuffer_width,
@@ -122,23 +207,41 @@ void kernel_main(uint32_t magic, multiboot_info_t* mbi) {
         // Let's stabilize the timeline with text mode first.
         graphics_init(0, 0, 0, 0, 0); // This triggers text mode in graphics.c
     }
-
-extern void pic_remap(int, int);
-
+    
     if (graphics_is_available()) {
         /* GRAPHICS MODE */
         init_gdt();
-        init_idt();
-        pic_remap(0x20, 0x28);
+        smp_init();
+        install_interrupts();
+        timer_init(TIMER_HZ);
+        interrupt_register(timer_vector(), timer_irq);
+        
+        // Trace events stream out of COM1 from its transmit interrupt
+        serial_init();
+        trace_init();
+        serial_set_source(trace_read);
+        profile_init();   // Sampling starts from the desktop (F9)
         gui_init();
         
+        // Fields run preemptively while the GUI waits for its next frame
+        init_cognitive_fields();
+        create_excitation("Kernel Monitor", task_kernel_monitor, 10);
+        create_excitation("Memory Dream", task_memory_dream, 5);
+        timer_set_idle_handler(field_idle_until);
+        
+        // The other CPUs only run fields
+        smp_start();
+        
         // Enable interrupts
         asm volatile("sti");
         
-        /* Enter GUI Loop */
+        /* Enter GUI Loop: real frame delta, halted between frames */
+        timer_frame_init(GUI_TARGET_FPS);
         while(1) {
-            gui_update(0.016f); // 60 FPS delta
+            gui_update(timer_frame_begin());
             gui_render();
+            serial_pump();   // Restart the trace stream if the UART went idle
+            timer_frame_end();
         }
     } else {
         /* TEXT MODE FALLBACK */
@@ -171,8 +274,8 @@ extern void pic_remap(int, int);
         }
         
         init_gdt();
-        init_idt();
-        pic_remap(0x20, 0x28);
+        smp_init();
+        install_interrupts();
         asm volatile("sti");
         
         while(1) {
@@ -1,22 +1,137 @@
 #include "../include/io.h"
+#include "../include/input.h"
 
-extern void terminal_writestring(const char*);
-extern void terminal_putchar(char);
+#define KEYBOARD_DATA  0x60
 
-extern void create_excitation(const char* name, void (*function)(void), uint32_t initial_energy);
+/* Scancode set 1, make codes 0x00-0x58. Printable keys map to their
+   unshifted character; the rest to keycode_t values. */
+static const uint8_t scancode_keys[0x59] = {
+    KEY_NONE, KEY_ESCAPE, '1', '2', '3', '4', '5', '6',
+    '7', '8', '9', '0', '-', '=', KEY_BACKSPACE, KEY_TAB,
+    'q', 'w', 'e', 'r', 't', 'y', 'u', 'i',
+    'o', 'p', '[', ']', KEY_ENTER, KEY_LCTRL, 'a', 's',
+    'd', 'f', 'g', 'h', 'j', 'k', 'l', ';',
+    '\'', '`', KEY_LSHIFT, '\\', 'z', 'x', 'c', 'v',
+    'b', 'n', 'm', ',', '.', '/', KEY_RSHIFT, '*',
+    KEY_LALT, KEY_SPACE, KEY_CAPS_LOCK, KEY_F1, KEY_F2, KEY_F3, KEY_F4, KEY_F5,
+    KEY_F6, KEY_F7, KEY_F8, KEY_F9, KEY_F10, KEY_NUM_LOCK, KEY_SCROLL_LOCK, '7',
+    '8', '9', '-', '4', '5', '6', '+', '1',
+    '2', '3', '0', '.', KEY_UNKNOWN, KEY_UNKNOWN, KEY_UNKNOWN, KEY_F11,
+    KEY_F12
+};
 
-void task_observer_interaction(void) {
-    terminal_writestring(" [ OBSERVER ] Interaction Detected: Collapsing Possibilities...\n");
+/* Shift row above the digits 0-9 */
+static const char shifted_digits[10] = { ')', '!', '@', '#', '$', '%', '^', '&', '*', '(' };
+
+static uint8_t modifiers = 0;
+static uint8_t extended = 0;      // Last byte was the 0xE0 prefix
+static uint8_t pause_skip = 0;    // Bytes left of an 0xE1 (Pause) sequence
+
+/* IRQ 1: fetch the byte and queue it; translation happens in the main loop */
+void keyboard_irq(void) {
+    input_push_scancode(inb(KEYBOARD_DATA));
+}
+
+static uint8_t extended_key(uint8_t code) {
+    switch (code) {
+        case 0x1C: return KEY_ENTER;       // Keypad Enter
+        case 0x1D: return KEY_RCTRL;
+        case 0x35: return '/';             // Keypad /
+        case 0x38: return KEY_RALT;
+        case 0x47: return KEY_HOME;
+        case 0x48: return KEY_UP;
+        case 0x49: return KEY_PAGE_UP;
+        case 0x4B: return KEY_LEFT;
+        case 0x4D: return KEY_RIGHT;
+        case 0x4F: return KEY_END;
+        case 0x50: return KEY_DOWN;
+        case 0x51: return KEY_PAGE_DOWN;
+        case 0x52: return KEY_INSERT;
+        case 0x53: return KEY_DELETE;
+        default:   return KEY_UNKNOWN;
+    }
 }
 
-void keyboard_handler() {
-    uint8_t scancode = inb(0x60);
+static char shift_char(char c) {
+    if (c >= 'a' && c <= 'z') return c - 'a' + 'A';
+    if (c >= '0' && c <= '9') return shifted_digits[c - '0'];
     
-    if (!(scancode & 0x80)) {
-        // High energy excitation from user input
-        create_excitation("User Observation", task_observer_interaction, 20);
+    switch (c) {
+        case '-':  return '_';
+        case '=':  return '+';
+        case '[':  return '{';
+        case ']':  return '}';
+        case ';':  return ':';
+        case '\'': return '"';
+        case '`':  return '~';
+        case '\\': return '|';
+        case ',':  return '<';
+        case '.':  return '>';
+        case '/':  return '?';
+        default:   return c;
+    }
+}
+
+static void track_modifier(uint8_t key, uint8_t pressed) {
+    uint8_t mask;
+    
+    switch (key) {
+        case KEY_LSHIFT: case KEY_RSHIFT: mask = KEY_MOD_SHIFT; break;
+        case KEY_LCTRL:  case KEY_RCTRL:  mask = KEY_MOD_CTRL;  break;
+        case KEY_LALT:   case KEY_RALT:   mask = KEY_MOD_ALT;   break;
+        case KEY_CAPS_LOCK:
+            if (pressed) modifiers ^= KEY_MOD_CAPS;
+            return;
+        default:
+            return;
     }
     
-    // Send EOI
-    outb(0x20, 0x20);
+    // Left and right share one bit, so releasing either clears it
+    if (pressed) modifiers |= mask;
+    else modifiers &= ~mask;
+}
+
+/* Feed one raw byte; returns 1 when it completes a key event */
+uint8_t keyboard_translate(uint8_t scancode, input_event_t* event) {
+    if (pause_skip) {
+        pause_skip--;
+        return 0;
+    }
+    if (scancode == 0xE0) {
+        extended = 1;
+        return 0;
+    }
+    if (scancode == 0xE1) {
+        pause_skip = 2;
+        return 0;
+    }
+    
+    uint8_t pressed = !(scancode & 0x80);
+    uint8_t code = scancode & 0x7F;
+    uint8_t key;
+    
+    if (extended) {
+        extended = 0;
+        // Fake shifts around extended keys carry no information
+        if (code == 0x2A || code == 0x36) return 0;
+        key = extended_key(code);
+    } else {
+        key = code < sizeof(scancode_keys) ? scancode_keys[code] : KEY_UNKNOWN;
+    }
+    
+    track_modifier(key, pressed);
+    
+    event->keycode = key;
+    event->pressed = pressed;
+    event->modifiers = modifiers;
+    event->ascii = 0;
+    
+    if (key >= ' ' && key < 0x7F) {
+        uint8_t shift = (modifiers & KEY_MOD_SHIFT) != 0;
+        if ((modifiers & KEY_MOD_CAPS) && key >= 'a' && key <= 'z') shift = !shift;
+        event->ascii = shift ? shift_char(key) : key;
+    } else if (key == KEY_ENTER || key == KEY_TAB || key == KEY_BACKSPACE) {
+        event->ascii = key;
+    }
+    return 1;
 }
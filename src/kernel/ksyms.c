@@ -0,0 +1,40 @@
+#include "../include/ksyms.h"
+
+extern const uint8_t ksyms[];       // linker.ld: _ksyms
+extern const uint8_t ksyms_end[];   // linker.ld: _ksyms_end
+
+typedef struct {
+    uint32_t magic;
+    uint32_t count;
+} ksyms_header_t;
+
+typedef struct {
+    uint32_t addr;
+    uint32_t name;       // Offset from the start of the table
+} ksyms_entry_t;
+
+uint8_t ksyms_present(void) {
+    const ksyms_header_t* header = (const ksyms_header_t*)ksyms;
+    return header->magic == KSYMS_MAGIC && header->count > 1 &&
+           sizeof(ksyms_header_t) + header->count * sizeof(ksyms_entry_t) <= (uint32_t)(ksyms_end - ksyms);
+}
+
+const char* ksyms_lookup(uint32_t addr, uint32_t* start) {
+    if (!ksyms_present()) return 0;
+    
+    const ksyms_header_t* header = (const ksyms_header_t*)ksyms;
+    const ksyms_entry_t* entries = (const ksyms_entry_t*)(header + 1);
+    
+    // Last entry at or below addr; the end marker is never a match
+    uint32_t lo = 0, hi = header->count;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (entries[mid].addr <= addr) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == 0 || lo == header->count) return 0;
+    
+    const ksyms_entry_t* entry = &entries[lo - 1];
+    if (start) *start = entry->addr;
+    return (const char*)ksyms + entry->name;
+}
@@ -0,0 +1,257 @@
+#include "../include/mem.h"
+#include "../include/cpu.h"
+#include "../include/io.h"
+
+/* The loops below must stay loops: GCC would otherwise turn them back
+   into calls to the functions they implement */
+#pragma GCC optimize("no-tree-loop-distribute-patterns")
+
+typedef uint32_t mem_word_t __attribute__((may_alias, aligned(1)));
+
+static size_t stream_min = (size_t)-1;   // No streaming until mem_init()
+
+/* With ERMS, rep movs switches to its own cache-bypassing protocol for
+   large sizes and beats four-byte movnti stores */
+void mem_init(void) {
+    if (cpu_has(CPU_FEATURE_SSE2) && !cpu_has(CPU_FEATURE_ERMS)) stream_min = MEM_STREAM_MIN;
+}
+
+uint8_t mem_streaming(void) {
+    return stream_min != (size_t)-1;
+}
+
+static inline uint32_t load32(const uint8_t* p) {
+    return *(const mem_word_t*)p;
+}
+
+static inline void store32(uint8_t* p, uint32_t v) {
+    *(mem_word_t*)p = v;
+}
+
+static inline void stream32(uint8_t* p, uint32_t v) {
+    asm volatile ("movnti %1, %0" : "=m"(*(mem_word_t*)p) : "r"(v));
+}
+
+/* Below MEM_SMALL: a head and a tail that may overlap, every load before
+   the first store, so memmove can use it too */
+static inline void copy_small(uint8_t* d, const uint8_t* s, size_t n) {
+    if (n >= 16) {
+        uint32_t a0 = load32(s), a1 = load32(s + 4), a2 = load32(s + 8), a3 = load32(s + 12);
+        uint32_t b0 = load32(s + n - 16), b1 = load32(s + n - 12);
+        uint32_t b2 = load32(s + n - 8), b3 = load32(s + n - 4);
+        store32(d, a0);
+        store32(d + 4, a1);
+        store32(d + 8, a2);
+        store32(d + 12, a3);
+        store32(d + n - 16, b0);
+        store32(d + n - 12, b1);
+        store32(d + n - 8, b2);
+        store32(d + n - 4, b3);
+    } else if (n >= 8) {
+        uint32_t a0 = load32(s), a1 = load32(s + 4);
+        uint32_t b0 = load32(s + n - 8), b1 = load32(s + n - 4);
+        store32(d, a0);
+        store32(d + 4, a1);
+        store32(d + n - 8, b0);
+        store32(d + n - 4, b1);
+    } else if (n >= 4) {
+        uint32_t a = load32(s), b = load32(s + n - 4);
+        store32(d, a);
+        store32(d + n - 4, b);
+    } else if (n) {
+        uint8_t a = s[0], b = s[n / 2], c = s[n - 1];
+        d[0] = a;
+        d[n / 2] = b;
+        d[n - 1] = c;
+    }
+}
+
+/* Below MEM_REP_MIN: 16 bytes per step, and the last 16 bytes again from
+   the end instead of a byte tail. Only for copies that do not overlap. */
+static inline void copy_words(uint8_t* d, const uint8_t* s, size_t n) {
+    const uint8_t* end = s + n - 16;
+    uint8_t* dend = d + n - 16;
+    for (; s < end; s += 16, d += 16) {
+        uint32_t a = load32(s), b = load32(s + 4), c = load32(s + 8), e = load32(s + 12);
+        store32(d, a);
+        store32(d + 4, b);
+        store32(d + 8, c);
+        store32(d + 12, e);
+    }
+    uint32_t a = load32(end), b = load32(end + 4), c = load32(end + 8), e = load32(end + 12);
+    store32(dend, a);
+    store32(dend + 4, b);
+    store32(dend + 8, c);
+    store32(dend + 12, e);
+}
+
+static inline void set_words(uint8_t* d, uint32_t v, size_t n) {
+    uint8_t* end = d + n - 16;
+    for (; d < end; d += 16) {
+        store32(d, v);
+        store32(d + 4, v);
+        store32(d + 8, v);
+        store32(d + 12, v);
+    }
+    store32(end, v);
+    store32(end + 4, v);
+    store32(end + 8, v);
+    store32(end + 12, v);
+}
+
+static inline void set_small(uint8_t* d, uint32_t v, size_t n) {
+    if (n >= 16) {
+        store32(d, v);
+        store32(d + 4, v);
+        store32(d + 8, v);
+        store32(d + 12, v);
+        store32(d + n - 16, v);
+        store32(d + n - 12, v);
+        store32(d + n - 8, v);
+        store32(d + n - 4, v);
+    } else if (n >= 8) {
+        store32(d, v);
+        store32(d + 4, v);
+        store32(d + n - 8, v);
+        store32(d + n - 4, v);
+    } else if (n >= 4) {
+        store32(d, v);
+        store32(d + n - 4, v);
+    } else if (n) {
+        d[0] = v;
+        d[n / 2] = v;
+        d[n - 1] = v;
+    }
+}
+
+/* Forward string copy; also right for an overlap with dst below src */
+static inline void copy_rep(uint8_t* d, const uint8_t* s, size_t n) {
+    size_t words = n >> 2;
+    asm volatile ("rep movsl\n\t"
+                  "movl %3, %%ecx\n\t"
+                  "rep movsb"
+                  : "+S"(s), "+D"(d), "+c"(words)
+                  : "r"(n & 3)
+                  : "memory");
+}
+
+static inline void set_rep(uint8_t* d, uint32_t v, size_t n) {
+    size_t words = n >> 2;
+    asm volatile ("rep stosl\n\t"
+                  "movl %3, %%ecx\n\t"
+                  "rep stosb"
+                  : "+D"(d), "+c"(words)
+                  : "a"(v), "r"(n & 3)
+                  : "memory");
+}
+
+/* Bytes to the next multiple of align. The callers cover them with one
+   unaligned word and go on from there; n is at least MEM_SMALL. */
+static inline size_t align_head(uint8_t* d, size_t align) {
+    return (align - ((uint32_t)d & (align - 1))) & (align - 1);
+}
+
+/* 16 bytes per step to an aligned destination. sfence orders the
+   weakly-ordered stores before whatever follows. */
+static void copy_stream(uint8_t* d, const uint8_t* s, size_t n) {
+    size_t head = align_head(d, 16);
+    copy_rep(d, s, head);
+    d += head;
+    s += head;
+    n -= head;
+    
+    for (size_t blocks = n >> 4; blocks; blocks--) {
+        uint32_t a = load32(s), b = load32(s + 4), c = load32(s + 8), e = load32(s + 12);
+        stream32(d, a);
+        stream32(d + 4, b);
+        stream32(d + 8, c);
+        stream32(d + 12, e);
+        d += 16;
+        s += 16;
+    }
+    asm volatile ("sfence" : : : "memory");
+    copy_rep(d, s, n & 15);
+}
+
+static void set_stream(uint8_t* d, uint32_t v, size_t n) {
+    size_t head = align_head(d, 16);
+    set_rep(d, v, head);
+    d += head;
+    n -= head;
+    
+    for (size_t blocks = n >> 4; blocks; blocks--) {
+        stream32(d, v);
+        stream32(d + 4, v);
+        stream32(d + 8, v);
+        stream32(d + 12, v);
+        d += 16;
+    }
+    asm volatile ("sfence" : : : "memory");
+    set_rep(d, v, n & 15);
+}
+
+/* Highest address first, for dst above an overlapping src. The stubs
+   do not clear DF on interrupt entry, so no interrupt may see it set. */
+static void copy_backward(uint8_t* d, const uint8_t* s, size_t n) {
+    size_t bytes = n & 3;
+    s += n - 1;
+    d += n - 1;
+    uint32_t flags = irq_save();
+    asm volatile ("std\n\t"
+                  "rep movsb\n\t"
+                  "subl $3, %%esi\n\t"
+                  "subl $3, %%edi\n\t"
+                  "movl %3, %%ecx\n\t"
+                  "rep movsl\n\t"
+                  "cld"
+                  : "+S"(s), "+D"(d), "+c"(bytes)
+                  : "r"(n >> 2)
+                  : "memory");
+    irq_restore(flags);
+}
+
+void* memcpy(void* dst, const void* src, size_t n) {
+    uint8_t* d = dst;
+    const uint8_t* s = src;
+    
+    if (n < MEM_SMALL) {
+        copy_small(d, s, n);
+    } else if (n < MEM_REP_MIN) {
+        copy_words(d, s, n);
+    } else if (n < stream_min) {
+        size_t head = align_head(d, 4);
+        store32(d, load32(s));
+        copy_rep(d + head, s + head, n - head);
+    } else {
+        copy_stream(d, s, n);
+    }
+    return dst;
+}
+
+void* memmove(void* dst, const void* src, size_t n) {
+    uint8_t* d = dst;
+    const uint8_t* s = src;
+    
+    if (n < MEM_SMALL) copy_small(d, s, n);
+    else if (d <= s || d >= s + n) copy_rep(d, s, n);
+    else copy_backward(d, s, n);
+    return dst;
+}
+
+void* memset(void* dst, int c, size_t n) {
+    uint8_t* d = dst;
+    uint32_t v = (uint8_t)c * 0x01010101u;
+    
+    if (n < MEM_SMALL) {
+        set_small(d, v, n);
+    } else if (n < MEM_REP_MIN) {
+        set_words(d, v, n);
+    } else if (n < stream_min) {
+        size_t head = align_head(d, 4);
+        store32(d, v);
+        set_rep(d + head, v, n - head);
+    } else {
+        set_stream(d, v, n);
+    }
+    return dst;
+}
@@ -0,0 +1,299 @@
+#include "../include/paging.h"
+#include "../include/pmm.h"
+#include "../include/cpu.h"
+#include "../include/mem.h"
+#include "../include/io.h"
+
+#define MSR_PAT             0x277
+#define MSR_MTRR_CAP        0x0FE
+#define MSR_MTRR_DEF_TYPE   0x2FF
+#define MSR_MTRR_PHYSBASE0  0x200   // PHYSMASKn follows PHYSBASEn; pairs are 2 apart
+
+#define MTRR_CAP_COUNT   0xFF       // Variable ranges
+#define MTRR_CAP_WC      0x400
+#define MTRR_DEF_ENABLE  0x800
+#define MTRR_MASK_VALID  0x800
+#define MTRR_TYPE_WC     0x01
+
+/* PAT entries 0-3, and 4-7 alike: WB, WC, UC-, UC. Entry 1 is WT after
+   reset; as WC it lets a page select write-combining with PWT alone. */
+#define PAT_VALUE  0x0007010600070106ULL
+
+#define CR0_WP   0x00010000
+#define CR0_NW   0x20000000
+#define CR0_CD   0x40000000
+#define CR0_PG   0x80000000
+#define CR4_PSE  0x00000010
+
+#define PAGE_FRAME   0xFFFFF000
+#define LARGE_FRAME  0xFFC00000
+#define PAGES_PER_TABLE  1024
+
+static uint32_t page_directory[1024] __attribute__((aligned(4096)));
+static uint8_t use_large = 0;
+static uint8_t use_pat = 0;
+static uint8_t enabled = 0;
+
+extern uint8_t end[];   // linker.ld: _end
+
+static inline uint32_t read_cr0(void) {
+    uint32_t value;
+    asm volatile ("movl %%cr0, %0" : "=r"(value));
+    return value;
+}
+
+static inline void write_cr0(uint32_t value) {
+    asm volatile ("movl %0, %%cr0" : : "r"(value) : "memory");
+}
+
+static inline uint32_t read_cr4(void) {
+    uint32_t value;
+    asm volatile ("movl %%cr4, %0" : "=r"(value));
+    return value;
+}
+
+static inline void write_cr4(uint32_t value) {
+    asm volatile ("movl %0, %%cr4" : : "r"(value) : "memory");
+}
+
+static inline void write_cr3(uint32_t value) {
+    asm volatile ("movl %0, %%cr3" : : "r"(value) : "memory");
+}
+
+static inline void wbinvd(void) {
+    asm volatile ("wbinvd" : : : "memory");
+}
+
+static inline void invalidate(uint32_t virt) {
+    if (enabled) asm volatile ("invlpg (%0)" : : "r"(virt) : "memory");
+}
+
+/* Entry bits for a memory type. Without a PAT, write-combining comes
+   from an MTRR over an ordinary write-back mapping. */
+static uint32_t cache_bits(paging_cache_t cache) {
+    switch (cache) {
+        case PAGING_CACHE_WC: return use_pat ? PAGE_PWT : 0;
+        case PAGING_CACHE_UC: return PAGE_PCD | PAGE_PWT;
+        default:              return 0;
+    }
+}
+
+/* Page table behind a directory slot, created empty or split from the
+   4MB page the slot held. 0 when out of memory. */
+static uint32_t* page_table(uint32_t slot) {
+    uint32_t pde = page_directory[slot];
+    if ((pde & PAGE_PRESENT) && !(pde & PAGE_LARGE)) return (uint32_t*)(pde & PAGE_FRAME);
+    
+    uint32_t* table = (uint32_t*)pmm_alloc_pages(1);
+    if (!table) return 0;
+    
+    if (pde & PAGE_PRESENT) {
+        // Same frames and type; bit 7 means PAT here, not size
+        for (uint32_t i = 0; i < PAGES_PER_TABLE; i++) {
+            table[i] = ((pde & LARGE_FRAME) + i * PAGING_PAGE_SIZE) | (pde & (PAGE_GLOBAL | 0x1F));
+        }
+    } else {
+        memset(table, 0, PAGING_PAGE_SIZE);
+    }
+    page_directory[slot] = (uint32_t)table | PAGE_PRESENT | PAGE_WRITE;
+    invalidate(slot << 22);
+    return table;
+}
+
+/* Pages touched by [addr, addr + size), without overflowing at 4GB */
+static uint32_t page_span(uint32_t addr, uint32_t size) {
+    return (uint32_t)(((uint64_t)size + (addr & ~PAGE_FRAME) + PAGING_PAGE_SIZE - 1) >> 12);
+}
+
+uint8_t paging_map(uint32_t virt, uint32_t phys, uint32_t size, paging_cache_t cache) {
+    uint32_t bits = PAGE_PRESENT | PAGE_WRITE | cache_bits(cache);
+    uint32_t pages = page_span(virt, size);
+    virt &= PAGE_FRAME;
+    phys &= PAGE_FRAME;
+    
+    uint32_t flags = irq_save();
+    while (pages) {
+        uint32_t slot = virt >> 22;
+        uint32_t step;
+        
+        if (use_large && !(virt & ~LARGE_FRAME) && !(phys & ~LARGE_FRAME) && pages >= PAGES_PER_TABLE) {
+            uint32_t old = page_directory[slot];
+            page_directory[slot] = phys | bits | PAGE_LARGE;
+            if ((old & PAGE_PRESENT) && !(old & PAGE_LARGE)) pmm_free_pages(old & PAGE_FRAME, 1);
+            step = PAGES_PER_TABLE;
+        } else {
+            uint32_t* table = page_table(slot);
+            if (!table) {
+                irq_restore(flags);
+                return 0;
+            }
+            table[(virt >> 12) & 0x3FF] = phys | bits;
+            step = 1;
+        }
+        
+        invalidate(virt);
+        virt += step * PAGING_PAGE_SIZE;
+        phys += step * PAGING_PAGE_SIZE;
+        pages -= step;
+    }
+    irq_restore(flags);
+    return 1;
+}
+
+void paging_unmap(uint32_t virt, uint32_t size) {
+    uint32_t pages = page_span(virt, size);
+    virt &= PAGE_FRAME;
+    
+    uint32_t flags = irq_save();
+    while (pages) {
+        uint32_t slot = virt >> 22;
+        uint32_t pde = page_directory[slot];
+        uint32_t step = PAGES_PER_TABLE - ((virt >> 12) & 0x3FF);   // To the next slot
+        
+        if ((pde & PAGE_PRESENT) && (pde & PAGE_LARGE) && (step < PAGES_PER_TABLE || pages < step)) {
+            // Part of a 4MB page goes: keep the rest as small pages
+            if (!page_table(slot)) break;
+            continue;
+        }
+        
+        if ((pde & PAGE_PRESENT) && !(pde & PAGE_LARGE)) {
+            ((uint32_t*)(pde & PAGE_FRAME))[(virt >> 12) & 0x3FF] = 0;
+            step = 1;
+        } else {
+            page_directory[slot] = 0;
+        }
+        
+        if (step > pages) step = pages;
+        invalidate(virt);
+        virt += step * PAGING_PAGE_SIZE;
+        pages -= step;
+    }
+    irq_restore(flags);
+}
+
+uint8_t paging_translate(uint32_t virt, uint32_t* phys) {
+    if (!enabled) {
+        *phys = virt;
+        return 1;
+    }
+    
+    uint32_t pde = page_directory[virt >> 22];
+    if (!(pde & PAGE_PRESENT)) return 0;
+    if (pde & PAGE_LARGE) {
+        *phys = (pde & LARGE_FRAME) | (virt & ~LARGE_FRAME);
+        return 1;
+    }
+    
+    uint32_t pte = ((uint32_t*)(pde & PAGE_FRAME))[(virt >> 12) & 0x3FF];
+    if (!(pte & PAGE_PRESENT)) return 0;
+    *phys = (pte & PAGE_FRAME) | (virt & ~PAGE_FRAME);
+    return 1;
+}
+
+uint8_t paging_enabled(void) {
+    return enabled;
+}
+
+/* The variable-range MTRR pair mtrr_set_wc() took; 0 if none. The SDM
+   wants identical MTRRs on every CPU, so each AP gets it too. */
+static uint32_t wc_msr = 0;
+static uint64_t wc_base, wc_mask;
+
+/* Load one variable-range pair following the SDM update sequence */
+static void mtrr_write(uint32_t msr, uint64_t base, uint64_t mask) {
+    uint32_t flags = irq_save();
+    uint32_t cr0 = read_cr0();
+    write_cr0((cr0 | CR0_CD) & ~CR0_NW);
+    wbinvd();
+    
+    uint64_t def = rdmsr(MSR_MTRR_DEF_TYPE);
+    wrmsr(MSR_MTRR_DEF_TYPE, def & ~(uint64_t)MTRR_DEF_ENABLE);
+    wrmsr(msr, base);
+    wrmsr(msr + 1, mask);
+    wrmsr(MSR_MTRR_DEF_TYPE, def);
+    
+    wbinvd();
+    write_cr0(cr0);
+    irq_restore(flags);
+}
+
+/* Make [base, base + size) write-combining with a free variable-range
+   MTRR. The range is rounded up to a power of two and has to be aligned
+   to it. */
+static void mtrr_set_wc(uint32_t base, uint32_t size) {
+    if (!cpu_has(CPU_FEATURE_MTRR) || !cpu_has(CPU_FEATURE_MSR)) return;
+    
+    uint64_t cap = rdmsr(MSR_MTRR_CAP);
+    if (!(cap & MTRR_CAP_WC)) return;
+    
+    uint32_t span = PAGING_PAGE_SIZE;
+    while (span && span < size) span <<= 1;
+    if (!span || (base & (span - 1))) return;
+    
+    // Mask over the physical address width the CPU reports (36 bits before it could)
+    uint32_t a, b, c, d;
+    uint32_t width = 36;
+    cpuid(0x80000000, &a, &b, &c, &d);
+    if (a >= 0x80000008) {
+        cpuid(0x80000008, &a, &b, &c, &d);
+        width = a & 0xFF;
+    }
+    uint64_t mask = (((uint64_t)1 << width) - 1) & ~(uint64_t)(span - 1);
+    
+    for (uint32_t i = 0; i < (cap & MTRR_CAP_COUNT); i++) {
+        uint32_t msr = MSR_MTRR_PHYSBASE0 + 2 * i;
+        if (rdmsr(msr + 1) & MTRR_MASK_VALID) continue;
+        
+        wc_base = base | MTRR_TYPE_WC;
+        wc_mask = mask | MTRR_MASK_VALID;
+        mtrr_write(msr, wc_base, wc_mask);
+        wc_msr = msr;
+        return;
+    }
+}
+
+static void enable(void) {
+    if (use_pat) {
+        wbinvd();
+        wrmsr(MSR_PAT, PAT_VALUE);
+        wbinvd();
+    }
+    if (use_large) write_cr4(read_cr4() | CR4_PSE);
+    write_cr3((uint32_t)page_directory);
+    write_cr0(read_cr0() | CR0_PG | CR0_WP);
+}
+
+void paging_init(const multiboot_info_t* mbi) {
+    use_large = cpu_has(CPU_FEATURE_PSE);
+    use_pat = cpu_has(CPU_FEATURE_PAT) && cpu_has(CPU_FEATURE_MSR);
+    
+    memset(page_directory, 0, sizeof(page_directory));
+    
+    // All RAM, and at least the kernel image, in whole 4MB slots. Without
+    // PSE each slot costs a page table; give up if there is no memory for it.
+    uint32_t frames = pmm_top_frame();
+    uint32_t kernel_frames = ((uint32_t)end + PAGING_PAGE_SIZE - 1) >> 12;
+    if (frames < kernel_frames) frames = kernel_frames;
+    uint32_t slots = (frames + PAGES_PER_TABLE - 1) / PAGES_PER_TABLE;
+    
+    for (uint32_t slot = 0; slot < slots; slot++) {
+        if (!paging_map(slot << 22, slot << 22, PAGING_LARGE_SIZE, PAGING_CACHE_WB)) return;
+    }
+    
+    if (mbi && (mbi->flags & MULTIBOOT_INFO_FRAMEBUFFER) && mbi->framebuffer_addr < 0x100000000ULL) {
+        uint32_t fb = (uint32_t)mbi->framebuffer_addr;
+        uint32_t size = mbi->framebuffer_pitch * mbi->framebuffer_height;
+        if (!paging_map(fb, fb, size, PAGING_CACHE_WC)) return;
+        if (!use_pat) mtrr_set_wc(fb, size);
+    }
+    
+    enable();
+    enabled = 1;
+}
+
+void paging_init_ap(void) {
+    if (!enabled) return;
+    
+    if (wc_msr) mtrr_write(wc_msr, wc_base, wc_mask);
+    enable();
+}
@@ -1,4 +1,5 @@
 #include "../include/io.h"
+#include "../include/pic.h"
 
 #define PIC1		0x20		/* IO base address for master PIC */
 #define PIC2		0xA0		/* IO base address for slave PIC */
@@ -38,3 +39,41 @@ void pic_remap(int offset1, int offset2) {
 	outb(PIC1_DATA, a1);   // restore saved masks.
 	outb(PIC2_DATA, a2);
 }
+
+#define PIC_EOI		0x20		/* End-of-interrupt command code */
+#define PIC_READ_ISR	0x0B		/* OCW3: next command read returns the ISR */
+
+void pic_send_eoi(uint8_t irq) {
+	if (irq >= 8)
+		outb(PIC2_COMMAND, PIC_EOI);
+
+	outb(PIC1_COMMAND, PIC_EOI);
+}
+
+void pic_mask(uint8_t irq) {
+	uint16_t port = irq < 8 ? PIC1_DATA : PIC2_DATA;
+
+	outb(port, inb(port) | (1 << (irq & 7)));
+}
+
+void pic_unmask(uint8_t irq) {
+	uint16_t port = irq < 8 ? PIC1_DATA : PIC2_DATA;
+
+	outb(port, inb(port) & ~(1 << (irq & 7)));
+
+	// Slave lines reach the CPU through the cascade on IRQ 2
+	if (irq >= 8)
+		outb(PIC1_DATA, inb(PIC1_DATA) & ~(1 << 2));
+}
+
+void pic_disable(void) {
+	outb(PIC1_DATA, 0xFF);
+	outb(PIC2_DATA, 0xFF);
+}
+
+uint16_t pic_in_service(void) {
+	outb(PIC1_COMMAND, PIC_READ_ISR);
+	outb(PIC2_COMMAND, PIC_READ_ISR);
+
+	return (inb(PIC2_COMMAND) << 8) | inb(PIC1_COMMAND);
+}
@@ -0,0 +1,73 @@
+#include "../include/pixel.h"
+#include "../include/cpu.h"
+
+pixel_ops_t pixel_ops = {
+    pixel_fill_scalar,
+    pixel_blit_scalar,
+    pixel_blit_scalar,
+    pixel_blend_scalar,
+    pixel_blend_solid_scalar
+};
+
+static uint8_t simd_enabled = 0;
+
+void pixel_init(void) {
+    // boot.S only turns on CR4.OSFXSR when CPUID reports SSE
+    if (cpu_has(CPU_FEATURE_SSE2)) {
+        pixel_ops.fill = pixel_fill_sse2;
+        pixel_ops.blit = pixel_blit_sse2;
+        pixel_ops.stream = pixel_stream_sse2;
+        pixel_ops.blend = pixel_blend_sse2;
+        pixel_ops.blend_solid = pixel_blend_solid_sse2;
+        simd_enabled = 1;
+    }
+}
+
+uint8_t pixel_simd_enabled(void) {
+    return simd_enabled;
+}
+
+void pixel_fill_scalar(uint32_t* dst, uint32_t color, uint32_t count) {
+    asm volatile ("rep stosl"
+                  : "+D"(dst), "+c"(count)
+                  : "a"(color)
+                  : "memory");
+}
+
+void pixel_blit_scalar(uint32_t* dst, const uint32_t* src, uint32_t count) {
+    asm volatile ("rep movsl"
+                  : "+S"(src), "+D"(dst), "+c"(count)
+                  : : "memory");
+}
+
+void pixel_blend_scalar(uint32_t* dst, const uint32_t* src, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t s = src[i];
+        uint32_t a = s >> 24;
+        
+        if (a == 0) continue;
+        if (a == 255) {
+            dst[i] = s;
+            continue;
+        }
+        
+        dst[i] = pixel_blend_one(dst[i], s);
+    }
+}
+
+void pixel_blend_solid_scalar(uint32_t* dst, uint32_t color, uint32_t count) {
+    uint32_t a = color >> 24;
+    
+    if (a == 0) return;
+    if (a == 255) {
+        pixel_fill_scalar(dst, color, count);
+        return;
+    }
+    
+    // Color terms are the same for every pixel; only the destination varies
+    pixel_premul_t src = pixel_premultiply(color);
+    
+    for (uint32_t i = 0; i < count; i++) {
+        dst[i] = pixel_blend_premul(dst[i], src);
+    }
+}
@@ -0,0 +1,203 @@
+/* SSE2 pixel kernels
+   Only reached through pixel_ops after pixel_init() has seen SSE2 in
+   CPUID, so the rest of the kernel keeps building for a plain i386. */
+#pragma GCC target("sse2")
+
+#include "../include/pixel.h"
+
+typedef int v4si __attribute__((vector_size(16)));
+typedef long long v2di __attribute__((vector_size(16)));
+typedef char v16qi __attribute__((vector_size(16)));
+typedef short v8hi __attribute__((vector_size(16)));
+typedef unsigned short v8hu __attribute__((vector_size(16)));
+
+static inline v4si load_unaligned(const uint32_t* p) {
+    return (v4si)__builtin_ia32_loaddqu((const char*)p);
+}
+
+static inline void store_unaligned(uint32_t* p, v4si v) {
+    __builtin_ia32_storedqu((char*)p, (v16qi)v);
+}
+
+void pixel_fill_sse2(uint32_t* dst, uint32_t color, uint32_t count) {
+    // Scalar head up to the first 16-byte boundary
+    while (count && ((uint32_t)dst & 15)) {
+        *dst++ = color;
+        count--;
+    }
+    
+    v4si v = { (int)color, (int)color, (int)color, (int)color };
+    while (count >= 16) {
+        ((v4si*)dst)[0] = v;
+        ((v4si*)dst)[1] = v;
+        ((v4si*)dst)[2] = v;
+        ((v4si*)dst)[3] = v;
+        dst += 16;
+        count -= 16;
+    }
+    while (count >= 4) {
+        *(v4si*)dst = v;
+        dst += 4;
+        count -= 4;
+    }
+    
+    while (count--) *dst++ = color;
+}
+
+void pixel_blit_sse2(uint32_t* dst, const uint32_t* src, uint32_t count) {
+    while (count && ((uint32_t)dst & 15)) {
+        *dst++ = *src++;
+        count--;
+    }
+    
+    while (count >= 16) {
+        v4si a = load_unaligned(src);
+        v4si b = load_unaligned(src + 4);
+        v4si c = load_unaligned(src + 8);
+        v4si d = load_unaligned(src + 12);
+        ((v4si*)dst)[0] = a;
+        ((v4si*)dst)[1] = b;
+        ((v4si*)dst)[2] = c;
+        ((v4si*)dst)[3] = d;
+        src += 16;
+        dst += 16;
+        count -= 16;
+    }
+    while (count >= 4) {
+        *(v4si*)dst = load_unaligned(src);
+        src += 4;
+        dst += 4;
+        count -= 4;
+    }
+    
+    while (count--) *dst++ = *src++;
+}
+
+void pixel_stream_sse2(uint32_t* dst, const uint32_t* src, uint32_t count) {
+    while (count && ((uint32_t)dst & 15)) {
+        *dst++ = *src++;
+        count--;
+    }
+    
+    // Non-temporal stores: full 64-byte lines go out without read-for-ownership
+    while (count >= 16) {
+        v4si a = load_unaligned(src);
+        v4si b = load_unaligned(src + 4);
+        v4si c = load_unaligned(src + 8);
+        v4si d = load_unaligned(src + 12);
+        __builtin_ia32_movntdq((v2di*)dst, (v2di)a);
+        __builtin_ia32_movntdq((v2di*)(dst + 4), (v2di)b);
+        __builtin_ia32_movntdq((v2di*)(dst + 8), (v2di)c);
+        __builtin_ia32_movntdq((v2di*)(dst + 12), (v2di)d);
+        src += 16;
+        dst += 16;
+        count -= 16;
+    }
+    while (count >= 4) {
+        __builtin_ia32_movntdq((v2di*)dst, (v2di)load_unaligned(src));
+        src += 4;
+        dst += 4;
+        count -= 4;
+    }
+    __builtin_ia32_sfence();
+    
+    while (count--) *dst++ = *src++;
+}
+
+/* Blend one 4-pixel vector, matching pixel_blend_scalar() bit for bit */
+static inline v4si blend4(v4si s, v4si d) {
+    const v16qi zero = { 0 };
+    const v8hu c128 = { 128, 128, 128, 128, 128, 128, 128, 128 };
+    const v8hu c255 = { 255, 255, 255, 255, 255, 255, 255, 255 };
+    const v4si alpha_byte = { (int)0xFF000000, (int)0xFF000000, (int)0xFF000000, (int)0xFF000000 };
+    
+    // Source alpha channel counts as fully covered
+    v4si s_full = s | alpha_byte;
+    
+    v8hu s_lo = (v8hu)__builtin_ia32_punpcklbw128((v16qi)s_full, zero);
+    v8hu s_hi = (v8hu)__builtin_ia32_punpckhbw128((v16qi)s_full, zero);
+    v8hu d_lo = (v8hu)__builtin_ia32_punpcklbw128((v16qi)d, zero);
+    v8hu d_hi = (v8hu)__builtin_ia32_punpckhbw128((v16qi)d, zero);
+    
+    // Broadcast each pixel's alpha word across its four channel words
+    v8hu a_lo = (v8hu)__builtin_ia32_pshufhw((v8hi)__builtin_ia32_pshuflw((v8hi)__builtin_ia32_punpcklbw128((v16qi)s, zero), 0xFF), 0xFF);
+    v8hu a_hi = (v8hu)__builtin_ia32_pshufhw((v8hi)__builtin_ia32_pshuflw((v8hi)__builtin_ia32_punpckhbw128((v16qi)s, zero), 0xFF), 0xFF);
+    
+    v8hu t_lo = s_lo * a_lo + d_lo * (c255 - a_lo) + c128;
+    v8hu t_hi = s_hi * a_hi + d_hi * (c255 - a_hi) + c128;
+    t_lo = (t_lo + (t_lo >> 8)) >> 8;
+    t_hi = (t_hi + (t_hi >> 8)) >> 8;
+    
+    return (v4si)__builtin_ia32_packuswb128((v8hi)t_lo, (v8hi)t_hi);
+}
+
+void pixel_blend_sse2(uint32_t* dst, const uint32_t* src, uint32_t count) {
+    const v4si alpha_byte = { (int)0xFF000000, (int)0xFF000000, (int)0xFF000000, (int)0xFF000000 };
+    const v4si zero = { 0 };
+    
+    while (count && ((uint32_t)dst & 15)) {
+        pixel_blend_scalar(dst++, src++, 1);
+        count--;
+    }
+    
+    while (count >= 4) {
+        v4si s = load_unaligned(src);
+        v4si a = s & alpha_byte;
+        
+        // Fully transparent or fully opaque groups skip the arithmetic
+        int clear = __builtin_ia32_pmovmskb128((v16qi)(a == zero));
+        if (clear != 0xFFFF) {
+            int solid = __builtin_ia32_pmovmskb128((v16qi)(a == alpha_byte));
+            if (solid == 0xFFFF) {
+                *(v4si*)dst = s;
+            } else {
+                *(v4si*)dst = blend4(s, *(v4si*)dst);
+            }
+        }
+        src += 4;
+        dst += 4;
+        count -= 4;
+    }
+    
+    pixel_blend_scalar(dst, src, count);
+}
+
+void pixel_blend_solid_sse2(uint32_t* dst, uint32_t color, uint32_t count) {
+    uint32_t a = color >> 24;
+    
+    if (a == 0) return;
+    if (a == 255) {
+        pixel_fill_sse2(dst, color, count);
+        return;
+    }
+    
+    while (count && ((uint32_t)dst & 15)) {
+        pixel_blend_solid_scalar(dst++, color, 1);
+        count--;
+    }
+    
+    // Per-channel color * alpha + rounding bias, computed once for the span
+    const v16qi zero = { 0 };
+    uint32_t full = color | 0xFF000000;
+    v4si c = { (int)full, (int)full, (int)full, (int)full };
+    v8hu cw = (v8hu)__builtin_ia32_punpcklbw128((v16qi)c, zero);
+    v8hu av = { a, a, a, a, a, a, a, a };
+    v8hu iav = { 255 - a, 255 - a, 255 - a, 255 - a, 255 - a, 255 - a, 255 - a, 255 - a };
+    v8hu c128 = { 128, 128, 128, 128, 128, 128, 128, 128 };
+    v8hu ca = cw * av + c128;
+    
+    while (count >= 4) {
+        v4si d = *(v4si*)dst;
+        v8hu d_lo = (v8hu)__builtin_ia32_punpcklbw128((v16qi)d, zero);
+        v8hu d_hi = (v8hu)__builtin_ia32_punpckhbw128((v16qi)d, zero);
+        v8hu t_lo = ca + d_lo * iav;
+        v8hu t_hi = ca + d_hi * iav;
+        t_lo = (t_lo + (t_lo >> 8)) >> 8;
+        t_hi = (t_hi + (t_hi >> 8)) >> 8;
+        *(v4si*)dst = (v4si)__builtin_ia32_packuswb128((v8hi)t_lo, (v8hi)t_hi);
+        dst += 4;
+        count -= 4;
+    }
+    
+    pixel_blend_solid_scalar(dst, color, count);
+}
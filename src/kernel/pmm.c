@@ -0,0 +1,252 @@
+#include "../include/pmm.h"
+#include "../include/spinlock.h"
+#include "../include/mem.h"
+
+#define PMM_REGION_MAX    32
+#define PMM_RESERVED_MAX  8
+#define PMM_LOW_FRAMES    (0x100000 >> PMM_PAGE_SHIFT)   // First megabyte
+#define PMM_FRAME_LIMIT   (1u << (32 - PMM_PAGE_SHIFT))  // 4GB
+
+#define FRAME_USED  0xFF   // Frame heads no free block
+
+/* Free blocks are linked through their own first bytes */
+typedef struct pmm_block {
+    struct pmm_block* next;
+    struct pmm_block* prev;
+} pmm_block_t;
+
+typedef struct {
+    uint32_t start, end;   // Frame numbers, end exclusive
+} pmm_range_t;
+
+extern uint8_t end[];   // linker.ld: _end
+
+static pmm_block_t* free_lists[PMM_MAX_ORDER + 1];
+static uint32_t free_orders = 0;   // Bit k set: free_lists[k] is non-empty
+
+/* Per frame: the order of the free block it heads, or FRAME_USED. A
+   block's buddy is free to merge exactly when its head says so. */
+static uint8_t* frame_order = 0;
+static uint32_t frame_count = 0;
+
+static uint32_t total_pages = 0;
+static uint32_t free_pages = 0;
+static spinlock_t pmm_lock = SPINLOCK_INIT;
+
+static pmm_range_t regions[PMM_REGION_MAX];     // Available RAM
+static uint32_t region_count = 0;
+static pmm_range_t reserved[PMM_RESERVED_MAX];
+static uint32_t reserved_count = 0;
+
+static inline pmm_block_t* frame_block(uint32_t frame) {
+    return (pmm_block_t*)(frame << PMM_PAGE_SHIFT);
+}
+
+static void list_push(uint32_t frame, uint32_t order) {
+    pmm_block_t* block = frame_block(frame);
+    
+    block->prev = 0;
+    block->next = free_lists[order];
+    if (block->next) block->next->prev = block;
+    free_lists[order] = block;
+    
+    free_orders |= 1u << order;
+    frame_order[frame] = order;
+}
+
+static void list_remove(uint32_t frame, uint32_t order) {
+    pmm_block_t* block = frame_block(frame);
+    
+    if (block->prev) block->prev->next = block->next;
+    else free_lists[order] = block->next;
+    if (block->next) block->next->prev = block->prev;
+    
+    if (!free_lists[order]) free_orders &= ~(1u << order);
+    frame_order[frame] = FRAME_USED;
+}
+
+/* Free one aligned block, merging upwards while its buddy is free too */
+static void free_block(uint32_t frame, uint32_t order) {
+    free_pages += 1u << order;
+    
+    while (order < PMM_MAX_ORDER) {
+        uint32_t buddy = frame ^ (1u << order);
+        if (buddy >= frame_count || frame_order[buddy] != order) break;
+        
+        list_remove(buddy, order);
+        frame &= ~(1u << order);
+        order++;
+    }
+    list_push(frame, order);
+}
+
+/* Free [start, stop) as the largest aligned blocks that tile it */
+static void free_range(uint32_t start, uint32_t stop) {
+    while (start < stop) {
+        uint32_t order = start ? (uint32_t)__builtin_ctz(start) : PMM_MAX_ORDER;
+        if (order > PMM_MAX_ORDER) order = PMM_MAX_ORDER;
+        while (start + (1u << order) > stop) order--;
+        
+        free_block(start, order);
+        start += 1u << order;
+    }
+}
+
+/* Add [addr, addr + len) to a range list, rounded out to whole frames
+   (or in, for available RAM) and clipped to 4GB */
+static void range_add(pmm_range_t* list, uint32_t* count, uint32_t max,
+                      uint64_t addr, uint64_t len, uint8_t inward) {
+    uint64_t limit = (uint64_t)PMM_FRAME_LIMIT << PMM_PAGE_SHIFT;
+    uint64_t stop = addr + len;
+    
+    if (*count >= max || addr >= limit) return;
+    if (stop > limit) stop = limit;
+    
+    uint32_t first, last;
+    if (inward) {
+        first = (addr + PMM_PAGE_SIZE - 1) >> PMM_PAGE_SHIFT;
+        last = stop >> PMM_PAGE_SHIFT;
+    } else {
+        first = addr >> PMM_PAGE_SHIFT;
+        last = (stop + PMM_PAGE_SIZE - 1) >> PMM_PAGE_SHIFT;
+    }
+    if (first < PMM_LOW_FRAMES) first = PMM_LOW_FRAMES;
+    if (first >= last) return;
+    
+    list[*count].start = first;
+    list[*count].end = last;
+    (*count)++;
+}
+
+/* First run of pages frames long in available RAM that no reservation
+   touches, or 0 */
+static uint32_t find_hole(uint32_t pages) {
+    for (uint32_t i = 0; i < region_count; i++) {
+        uint32_t at = regions[i].start;
+        
+        // Step past reservations until the run clears all of them
+        for (uint32_t r = 0; r < reserved_count; r++) {
+            if (reserved[r].start < at + pages && reserved[r].end > at) {
+                at = reserved[r].end;
+                r = (uint32_t)-1;
+            }
+        }
+        if (at + pages <= regions[i].end) return at;
+    }
+    return 0;
+}
+
+/* Free [start, stop) minus the reservations from index from on */
+static void add_available(uint32_t start, uint32_t stop, uint32_t from) {
+    for (uint32_t i = from; i < reserved_count && start < stop; i++) {
+        if (reserved[i].end <= start || reserved[i].start >= stop) continue;
+        
+        if (reserved[i].start > start) add_available(start, reserved[i].start, i + 1);
+        start = reserved[i].end;
+    }
+    
+    if (start < stop) {
+        total_pages += stop - start;
+        free_range(start, stop);
+    }
+}
+
+void pmm_init(const multiboot_info_t* mbi) {
+    if (!mbi) return;
+    
+    // Available RAM: the memory map, or the upper-memory size without one
+    if (mbi->flags & MULTIBOOT_INFO_MEM_MAP) {
+        uint32_t at = mbi->mmap_addr;
+        uint32_t stop = mbi->mmap_addr + mbi->mmap_length;
+        
+        while (at < stop) {
+            const multiboot_mmap_entry_t* entry = (const multiboot_mmap_entry_t*)at;
+            if (entry->type == MULTIBOOT_MEMORY_AVAILABLE) {
+                range_add(regions, &region_count, PMM_REGION_MAX, entry->addr, entry->len, 1);
+            }
+            at += entry->size + sizeof(entry->size);
+        }
+    } else if (mbi->flags & MULTIBOOT_INFO_MEMORY) {
+        range_add(regions, &region_count, PMM_REGION_MAX,
+                  0x100000, (uint64_t)mbi->mem_upper * 1024, 1);
+    }
+    
+    for (uint32_t i = 0; i < region_count; i++) {
+        if (regions[i].end > frame_count) frame_count = regions[i].end;
+    }
+    if (!frame_count) return;
+    
+    // Kernel image, boot information and framebuffer
+    range_add(reserved, &reserved_count, PMM_RESERVED_MAX, 0x100000, (uint32_t)end - 0x100000, 0);
+    range_add(reserved, &reserved_count, PMM_RESERVED_MAX, (uint32_t)mbi, sizeof(*mbi), 0);
+    if (mbi->flags & MULTIBOOT_INFO_MEM_MAP) {
+        range_add(reserved, &reserved_count, PMM_RESERVED_MAX, mbi->mmap_addr, mbi->mmap_length, 0);
+    }
+    if (mbi->flags & MULTIBOOT_INFO_FRAMEBUFFER) {
+        range_add(reserved, &reserved_count, PMM_RESERVED_MAX, mbi->framebuffer_addr,
+                  (uint64_t)mbi->framebuffer_pitch * mbi->framebuffer_height, 0);
+    }
+    
+    // One byte of state per frame, kept in the first hole that fits
+    uint32_t map_pages = (frame_count + PMM_PAGE_SIZE - 1) >> PMM_PAGE_SHIFT;
+    uint32_t map_frame = find_hole(map_pages);
+    if (!map_frame || reserved_count >= PMM_RESERVED_MAX) {
+        frame_count = 0;
+        return;
+    }
+    reserved[reserved_count].start = map_frame;
+    reserved[reserved_count].end = map_frame + map_pages;
+    reserved_count++;
+    
+    frame_order = (uint8_t*)frame_block(map_frame);
+    memset(frame_order, FRAME_USED, frame_count);
+    
+    for (uint32_t i = 0; i < region_count; i++) {
+        add_available(regions[i].start, regions[i].end, 0);
+    }
+}
+
+uint32_t pmm_alloc_pages(uint32_t count) {
+    if (!count || count > (1u << PMM_MAX_ORDER)) return 0;
+    
+    uint32_t order = count == 1 ? 0 : 32 - __builtin_clz(count - 1);
+    uint32_t flags = spin_lock_irqsave(&pmm_lock);
+    
+    // Smallest free block that holds count pages
+    uint32_t usable = free_orders & ~((1u << order) - 1);
+    if (!usable) {
+        spin_unlock_irqrestore(&pmm_lock, flags);
+        return 0;
+    }
+    uint32_t k = __builtin_ctz(usable);
+    uint32_t frame = (uint32_t)free_lists[k] >> PMM_PAGE_SHIFT;
+    list_remove(frame, k);
+    free_pages -= 1u << k;
+    
+    // Hand back what lies past count; this is the buddy split
+    free_range(frame + count, frame + (1u << k));
+    spin_unlock_irqrestore(&pmm_lock, flags);
+    
+    return frame << PMM_PAGE_SHIFT;
+}
+
+void pmm_free_pages(uint32_t addr, uint32_t count) {
+    uint32_t frame = addr >> PMM_PAGE_SHIFT;
+    if (!count || frame < PMM_LOW_FRAMES || frame + count > frame_count) return;
+    
+    uint32_t flags = spin_lock_irqsave(&pmm_lock);
+    free_range(frame, frame + count);
+    spin_unlock_irqrestore(&pmm_lock, flags);
+}
+
+uint32_t pmm_total_pages(void) {
+    return total_pages;
+}
+
+uint32_t pmm_top_frame(void) {
+    return frame_count;
+}
+
+uint32_t pmm_free_page_count(void) {
+    return free_pages;
+}
@@ -0,0 +1,317 @@
+#include "../include/profile.h"
+#include "../include/ksyms.h"
+#include "../include/serial.h"
+#include "../include/pmm.h"
+#include "../include/idt.h"
+#include "../include/io.h"
+
+#define CMOS_INDEX    0x70
+#define CMOS_DATA     0x71
+#define CMOS_NMI_OFF  0x80       // Index bit: NMIs held off while programming
+#define RTC_REG_A     0x0A       // Rate select in the low nibble
+#define RTC_REG_B     0x0B
+#define RTC_REG_C     0x0C       // Interrupt flags; reading it re-arms the IRQ
+#define RTC_B_PIE     0x40       // Periodic interrupt enable
+
+#define PROFILE_PROBES      8        // Slots tried before a sample is lost
+#define PROFILE_FRAME_SPAN  0x10000  // Largest step between two frames
+#define PROFILE_FUNCTIONS   128      // Distinct functions profile_top() ranks
+
+/* Folded output: a line must fit one SERIAL_REFILL chunk, so names are
+   cut at PROFILE_NAME_MAX characters */
+#define PROFILE_NAME_MAX    24
+#define PROFILE_LINE_MAX    (PROFILE_DEPTH * (PROFILE_NAME_MAX + 1) + 12)
+
+/* Written only from the RTC interrupt on the boot CPU. A slot is filled
+   before its count turns non-zero, and never changes stack after that. */
+typedef struct {
+    volatile uint32_t samples;
+    uint32_t hash;
+    uint32_t depth;
+    uint32_t pcs[PROFILE_DEPTH];     // Innermost first
+} profile_stack_t;
+
+static profile_stack_t stacks[PROFILE_STACKS];
+static volatile uint32_t sample_count = 0;
+static volatile uint32_t lost_count = 0;
+static volatile uint8_t running = 0;
+static uint8_t ready = 0;
+static uint32_t ram_top = 0;     // Frames must lie below this
+
+/* Serial dump in progress */
+enum { DUMP_HEADER, DUMP_STACKS };
+static volatile uint8_t dumping = 0;
+static uint8_t dump_stage;
+static uint32_t dump_slot;
+static uint8_t dump_resume_sampling;
+static serial_source_t dump_previous;
+
+static uint8_t cmos_read(uint8_t reg) {
+    outb(CMOS_INDEX, CMOS_NMI_OFF | reg);
+    return inb(CMOS_DATA);
+}
+
+static void cmos_write(uint8_t reg, uint8_t value) {
+    outb(CMOS_INDEX, CMOS_NMI_OFF | reg);
+    outb(CMOS_DATA, value);
+}
+
+static void rtc_ack(void) {
+    outb(CMOS_INDEX, RTC_REG_C);   // NMIs back on
+    inb(CMOS_DATA);
+}
+
+static uint32_t hash_stack(const uint32_t* pcs, uint32_t depth) {
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < depth; i++) {
+        hash = (hash ^ pcs[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static void record(const uint32_t* pcs, uint32_t depth) {
+    uint32_t hash = hash_stack(pcs, depth);
+    
+    for (uint32_t probe = 0; probe < PROFILE_PROBES; probe++) {
+        profile_stack_t* slot = &stacks[(hash + probe) & (PROFILE_STACKS - 1)];
+        
+        if (!slot->samples) {
+            slot->hash = hash;
+            slot->depth = depth;
+            for (uint32_t i = 0; i < depth; i++) slot->pcs[i] = pcs[i];
+            asm volatile ("" : : : "memory");   // Stores stay in order on x86
+            slot->samples = 1;
+            sample_count++;
+            return;
+        }
+        
+        if (slot->hash == hash && slot->depth == depth) {
+            uint32_t i = 0;
+            while (i < depth && slot->pcs[i] == pcs[i]) i++;
+            if (i == depth) {
+                slot->samples++;
+                sample_count++;
+                return;
+            }
+        }
+    }
+    lost_count++;
+}
+
+/* A frame above the last one, word aligned, in RAM and not too far off */
+static inline uint8_t frame_ok(uint32_t fp, uint32_t below) {
+    return fp > below && fp - below <= PROFILE_FRAME_SPAN && !(fp & 3) &&
+           fp >= 0x100000 && fp <= ram_top - 8;
+}
+
+static void profile_irq(registers_t* regs) {
+    rtc_ack();
+    
+    uint32_t pcs[PROFILE_DEPTH];
+    uint32_t depth = 0;
+    pcs[depth++] = regs->eip;
+    
+    // The interrupted code shares this stack, so its frames sit above regs
+    uint32_t below = (uint32_t)regs;
+    uint32_t fp = regs->ebp;
+    while (depth < PROFILE_DEPTH && frame_ok(fp, below)) {
+        uint32_t ret = ((uint32_t*)fp)[1];
+        if (!ret) break;
+        pcs[depth++] = ret;
+        below = fp;
+        fp = ((uint32_t*)fp)[0];
+    }
+    record(pcs, depth);
+}
+
+void profile_init(void) {
+    uint32_t frames = pmm_top_frame();
+    ram_top = frames >= (1u << (32 - PMM_PAGE_SHIFT)) ? 0xFFFFF000u : frames << PMM_PAGE_SHIFT;
+    
+    irq_register(PROFILE_IRQ, profile_irq);
+    
+    uint32_t flags = irq_save();
+    cmos_write(RTC_REG_A, (cmos_read(RTC_REG_A) & 0xF0) | PROFILE_RTC_RATE);
+    cmos_write(RTC_REG_B, cmos_read(RTC_REG_B) | RTC_B_PIE);
+    rtc_ack();
+    irq_restore(flags);
+    ready = 1;
+}
+
+static void set_sampling(uint8_t on) {
+    if (on) {
+        running = 1;
+        rtc_ack();               // A flag left set would hold the line
+        irq_unmask(PROFILE_IRQ);
+    } else {
+        irq_mask(PROFILE_IRQ);
+        running = 0;
+    }
+}
+
+void profile_start(void) {
+    if (!ready) return;
+    if (dumping) dump_resume_sampling = 1;
+    else set_sampling(1);
+}
+
+void profile_stop(void) {
+    if (!ready) return;
+    if (dumping) dump_resume_sampling = 0;
+    else set_sampling(0);
+}
+
+uint8_t profile_running(void) {
+    return dumping ? dump_resume_sampling : running;
+}
+
+void profile_reset(void) {
+    if (dumping) return;
+    
+    uint32_t flags = irq_save();
+    for (uint32_t i = 0; i < PROFILE_STACKS; i++) stacks[i].samples = 0;
+    sample_count = 0;
+    lost_count = 0;
+    irq_restore(flags);
+}
+
+uint32_t profile_sample_count(void) {
+    return sample_count;
+}
+
+uint32_t profile_lost_count(void) {
+    return lost_count;
+}
+
+uint32_t profile_top(profile_entry_t* out, uint32_t max) {
+    static profile_entry_t functions[PROFILE_FUNCTIONS];
+    uint32_t count = 0;
+    
+    // Self samples per function; functions past the table are left out
+    for (uint32_t i = 0; i < PROFILE_STACKS; i++) {
+        uint32_t samples = stacks[i].samples;
+        if (!samples) continue;
+        
+        uint32_t addr = stacks[i].pcs[0];
+        const char* name = ksyms_lookup(addr, &addr);
+        
+        uint32_t f = 0;
+        while (f < count && functions[f].addr != addr) f++;
+        if (f == count) {
+            if (count == PROFILE_FUNCTIONS) continue;
+            functions[count].name = name;
+            functions[count].addr = addr;
+            functions[count].samples = 0;
+            count++;
+        }
+        functions[f].samples += samples;
+    }
+    
+    // Partial selection sort: only the first max places matter
+    if (max > count) max = count;
+    for (uint32_t i = 0; i < max; i++) {
+        uint32_t best = i;
+        for (uint32_t j = i + 1; j < count; j++) {
+            if (functions[j].samples > functions[best].samples) best = j;
+        }
+        profile_entry_t swap = functions[i];
+        functions[i] = functions[best];
+        functions[best] = swap;
+        out[i] = functions[i];
+    }
+    return max;
+}
+
+/* Folded text */
+
+static char* put_str(char* p, const char* s, uint32_t max) {
+    while (*s && max--) *p++ = *s++;
+    return p;
+}
+
+static char* put_dec(char* p, uint32_t value) {
+    char digits[10];
+    int n = 0;
+    do {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    while (n) *p++ = digits[--n];
+    return p;
+}
+
+static char* put_frame(char* p, uint32_t pc) {
+    const char* name = ksyms_lookup(pc, 0);
+    if (name && *name) return put_str(p, name, PROFILE_NAME_MAX);
+    
+    *p++ = '0';
+    *p++ = 'x';
+    for (int shift = 28; shift >= 0; shift -= 4) {
+        *p++ = "0123456789abcdef"[(pc >> shift) & 0xF];
+    }
+    return p;
+}
+
+/* One stack, root first. Return addresses are looked up one byte back,
+   inside the call, so a call that ends its function still names it. */
+static uint32_t fold_stack(char* line, const profile_stack_t* stack) {
+    char* p = line;
+    for (uint32_t i = stack->depth; i-- > 0;) {
+        p = put_frame(p, i ? stack->pcs[i] - 1 : stack->pcs[i]);
+        *p++ = i ? ';' : ' ';
+    }
+    p = put_dec(p, stack->samples);
+    *p++ = '\n';
+    return p - line;
+}
+
+/* Serial source for the dump; puts the previous source back when done */
+static uint32_t dump_read(uint8_t* buf, uint32_t max) {
+    char line[PROFILE_LINE_MAX];
+    uint32_t used = 0;
+    
+    if (dump_stage == DUMP_HEADER) {
+        char* p = put_str(line, "# PXPROF BEGIN hz=", 32);
+        p = put_dec(p, PROFILE_HZ);
+        p = put_str(p, " samples=", 32);
+        p = put_dec(p, sample_count);
+        p = put_str(p, " lost=", 32);
+        p = put_dec(p, lost_count);
+        *p++ = '\n';
+        if ((uint32_t)(p - line) > max) return 0;
+        for (char* c = line; c < p; c++) buf[used++] = *c;
+        dump_stage = DUMP_STACKS;
+    }
+    
+    for (; dump_slot < PROFILE_STACKS; dump_slot++) {
+        if (!stacks[dump_slot].samples) continue;
+        uint32_t len = fold_stack(line, &stacks[dump_slot]);
+        if (max - used < len) return used;
+        for (uint32_t i = 0; i < len; i++) buf[used++] = line[i];
+    }
+    
+    const char* footer = "# PXPROF END\n";
+    uint32_t len = 0;
+    while (footer[len]) len++;
+    if (max - used < len) return used;
+    for (uint32_t i = 0; i < len; i++) buf[used++] = footer[i];
+    
+    // Called with interrupts off, so the handover is atomic
+    dumping = 0;
+    serial_set_source(dump_previous);
+    if (dump_resume_sampling) set_sampling(1);
+    return used;
+}
+
+uint8_t profile_dump(void) {
+    if (!serial_present() || dumping) return 0;
+    
+    dump_resume_sampling = running;
+    set_sampling(0);
+    dump_stage = DUMP_HEADER;
+    dump_slot = 0;
+    dumping = 1;
+    dump_previous = serial_set_source(dump_read);
+    serial_pump();
+    return 1;
+}
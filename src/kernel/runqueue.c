@@ -0,0 +1,55 @@
+#include "../include/runqueue.h"
+
+void runqueue_init(runqueue_t* rq) {
+    for (int i = 0; i < RUNQUEUE_WORDS; i++) rq->bitmap[i] = 0;
+    for (int i = 0; i < RUNQUEUE_LEVELS; i++) {
+        rq->head[i] = 0;
+        rq->tail[i] = 0;
+    }
+    rq->count = 0;
+}
+
+void runqueue_push(runqueue_t* rq, cognitive_field_t* field) {
+    uint32_t level = runqueue_level(field->energy);
+    
+    field->rq_owner = rq;
+    field->rq_level = level;
+    field->rq_next = 0;
+    field->rq_prev = rq->tail[level];
+    
+    if (rq->tail[level]) rq->tail[level]->rq_next = field;
+    else rq->head[level] = field;
+    rq->tail[level] = field;
+    
+    rq->bitmap[level >> 5] |= 1u << (level & 31);
+    rq->count++;
+}
+
+void runqueue_remove(runqueue_t* rq, cognitive_field_t* field) {
+    // The level it was queued at; its energy may have changed since
+    uint32_t level = field->rq_level;
+    
+    if (field->rq_prev) field->rq_prev->rq_next = field->rq_next;
+    else rq->head[level] = field->rq_next;
+    if (field->rq_next) field->rq_next->rq_prev = field->rq_prev;
+    else rq->tail[level] = field->rq_prev;
+    
+    field->rq_next = field->rq_prev = 0;
+    field->rq_owner = 0;
+    
+    if (!rq->head[level]) rq->bitmap[level >> 5] &= ~(1u << (level & 31));
+    rq->count--;
+}
+
+cognitive_field_t* runqueue_pop(runqueue_t* rq) {
+    // Highest word first, then the highest bit in it
+    for (int w = RUNQUEUE_WORDS - 1; w >= 0; w--) {
+        if (!rq->bitmap[w]) continue;
+        
+        uint32_t level = (w << 5) + (31 - __builtin_clz(rq->bitmap[w]));
+        cognitive_field_t* field = rq->head[level];
+        runqueue_remove(rq, field);
+        return field;
+    }
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include "../include/serial.h"
+#include "../include/io.h"
+#include "../include/idt.h"
+
+#define COM1          0x3F8
+#define UART_DATA     0          // DLAB 0: THR / RBR; DLAB 1: divisor low
+#define UART_IER      1          // DLAB 1: divisor high
+#define UART_IIR_FCR  2
+#define UART_LCR      3
+#define UART_MCR      4
+#define UART_LSR      5
+#define UART_SCRATCH  7
+
+#define IER_THRE      0x02
+#define LSR_THRE      0x20
+#define UART_FIFO     16
+
+/* Single producer side at a time (interrupts off), single consumer (IRQ 4).
+   Indices run free and are masked on access. */
+#define SERIAL_RING_SIZE  4096   // Power of two
+
+static uint8_t ring[SERIAL_RING_SIZE];
+static volatile uint32_t ring_head = 0;
+static volatile uint32_t ring_tail = 0;
+static uint8_t present = 0;
+static uint8_t tx_armed = 0;     // THRE interrupt enabled
+static serial_source_t source = 0;
+
+/* Append up to len bytes; interrupts must be off */
+static uint32_t ring_put(const uint8_t* data, uint32_t len) {
+    uint32_t room = SERIAL_RING_SIZE - (ring_head - ring_tail);
+    if (len > room) len = room;
+    
+    for (uint32_t i = 0; i < len; i++) {
+        ring[(ring_head + i) & (SERIAL_RING_SIZE - 1)] = data[i];
+    }
+    ring_head += len;
+    return len;
+}
+
+/* Pull from the source while it has bytes and the ring has room */
+static void refill(void) {
+    uint8_t chunk[SERIAL_REFILL];
+    
+    while (source && SERIAL_RING_SIZE - (ring_head - ring_tail) >= SERIAL_REFILL) {
+        uint32_t n = source(chunk, SERIAL_REFILL);
+        if (!n) break;
+        ring_put(chunk, n);
+    }
+}
+
+static void set_armed(uint8_t armed) {
+    if (armed == tx_armed) return;
+    tx_armed = armed;
+    outb(COM1 + UART_IER, armed ? IER_THRE : 0);   // Arming with THR empty raises it at once
+}
+
+static void serial_irq(registers_t* regs) {
+    (void)regs;
+    inb(COM1 + UART_IIR_FCR);    // Acknowledge
+    
+    if (ring_head - ring_tail < UART_FIFO) refill();
+    if (inb(COM1 + UART_LSR) & LSR_THRE) {
+        for (int i = 0; i < UART_FIFO && ring_tail != ring_head; i++) {
+            outb(COM1 + UART_DATA, ring[ring_tail & (SERIAL_RING_SIZE - 1)]);
+            ring_tail++;
+        }
+    }
+    set_armed(ring_tail != ring_head);
+}
+
+void serial_init(void) {
+    outb(COM1 + UART_IER, 0);
+    
+    // Nothing decodes the port: the scratch register reads back 0xFF
+    outb(COM1 + UART_SCRATCH, 0x5A);
+    if (inb(COM1 + UART_SCRATCH) != 0x5A) return;
+    
+    outb(COM1 + UART_LCR, 0x80); // DLAB
+    outb(COM1 + UART_DATA, 1);   // 115200 / 1
+    outb(COM1 + UART_IER, 0);
+    outb(COM1 + UART_LCR, 0x03); // 8N1
+    outb(COM1 + UART_IIR_FCR, 0xC7);   // FIFOs on and cleared
+    outb(COM1 + UART_MCR, 0x0B); // DTR, RTS, OUT2 (gates the IRQ line)
+    
+    present = 1;
+    irq_register(SERIAL_COM1_IRQ, serial_irq);
+    irq_unmask(SERIAL_COM1_IRQ);
+}
+
+uint8_t serial_present(void) {
+    return present;
+}
+
+uint32_t serial_write(const void* data, uint32_t len) {
+    if (!present) return 0;
+    
+    uint32_t flags = irq_save();
+    len = ring_put(data, len);
+    if (len) set_armed(1);
+    irq_restore(flags);
+    return len;
+}
+
+serial_source_t serial_set_source(serial_source_t fn) {
+    uint32_t flags = irq_save();
+    serial_source_t old = source;
+    source = fn;
+    irq_restore(flags);
+    return old;
+}
+
+void serial_pump(void) {
+    if (!present || !source) return;
+    
+    uint32_t flags = irq_save();
+    refill();
+    if (ring_tail != ring_head) set_armed(1);
+    irq_restore(flags);
+}
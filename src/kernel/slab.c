@@ -0,0 +1,288 @@
+#include "../include/slab.h"
+#include "../include/pmm.h"
+#include "../include/spinlock.h"
+
+#define KMEM_SLAB_MAGIC      0x534C4142   // "SLAB"
+#define KMEM_LARGE_MAGIC     0x4C415247   // "LARG"
+#define KMEM_MIN_OBJECTS     8            // Per slab, where the size allows
+#define KMEM_MAX_SLAB_PAGES  32
+#define KMEM_EMPTY_KEEP      1            // Empty slabs a cache holds on to
+
+/* kmalloc slabs and large blocks are all this big or bigger and aligned
+   to it, so kfree() finds the header of either by masking */
+#define KMALLOC_CHUNK_PAGES   4
+#define KMALLOC_CHUNK         (KMALLOC_CHUNK_PAGES * PMM_PAGE_SIZE)
+#define KMALLOC_CLASSES       (KMALLOC_MAX_SHIFT - KMALLOC_MIN_SHIFT + 1)
+#define KMALLOC_LARGE_OFFSET  16          // Keeps large blocks 16-byte aligned
+
+/* Header at the base of every slab */
+typedef struct kmem_slab {
+    uint32_t magic;
+    kmem_cache_t* cache;
+    struct kmem_slab* next;
+    struct kmem_slab* prev;
+    void* free;                  // First free object
+    uint32_t in_use;
+} kmem_slab_t;
+
+/* Header at the base of a large kmalloc block */
+typedef struct {
+    uint32_t magic;
+    uint32_t pages;
+} kmem_large_t;
+
+struct kmem_cache {
+    const char* name;
+    uint32_t object_size;
+    uint32_t stride;             // Object, plus its free link with a constructor
+    uint32_t link_offset;        // Free-list link within a free object
+    uint32_t first_offset;       // First object, past the slab header
+    uint32_t slab_pages;
+    uint32_t per_slab;
+    void (*ctor)(void* object);
+    
+    spinlock_t lock;             // Lists and counters below
+    kmem_slab_t* partial;
+    kmem_slab_t* full;
+    kmem_slab_t* empty;
+    uint32_t empty_count;
+    
+    uint32_t slabs;
+    uint32_t in_use;
+    uint32_t allocs, frees;
+    struct kmem_cache* next;     // All caches, in creation order
+};
+
+static kmem_cache_t cache_cache;              // Where every other cache lives
+static kmem_cache_t* caches = 0;
+static kmem_cache_t** caches_tail = &caches;
+
+static kmem_cache_t* kmalloc_caches[KMALLOC_CLASSES];
+static const char* kmalloc_names[KMALLOC_CLASSES] = {
+    "kmalloc-16", "kmalloc-32", "kmalloc-64", "kmalloc-128",
+    "kmalloc-256", "kmalloc-512", "kmalloc-1024", "kmalloc-2048"
+};
+
+static inline uint32_t align_up(uint32_t value, uint32_t align) {
+    return (value + align - 1) & ~(align - 1);
+}
+
+/* Lay a cache out. Without a constructor a free object holds its own
+   link; with one the link goes after the object so the constructed state
+   survives. slab_pages 0 picks the smallest slab with KMEM_MIN_OBJECTS. */
+static uint8_t cache_setup(kmem_cache_t* cache, const char* name, uint32_t size,
+                           uint32_t align, void (*ctor)(void*), uint32_t slab_pages) {
+    if (align < sizeof(void*)) align = sizeof(void*);
+    if (align & (align - 1)) return 0;
+    
+    uint32_t stride = align_up(size ? size : 1, sizeof(void*));
+    cache->link_offset = 0;
+    if (ctor) {
+        cache->link_offset = stride;
+        stride += sizeof(void*);
+    }
+    cache->stride = align_up(stride, align);
+    cache->first_offset = align_up(sizeof(kmem_slab_t), align);
+    
+    if (!slab_pages) {
+        slab_pages = 1;
+        while (slab_pages < KMEM_MAX_SLAB_PAGES &&
+               (slab_pages * PMM_PAGE_SIZE - cache->first_offset) / cache->stride < KMEM_MIN_OBJECTS) {
+            slab_pages <<= 1;
+        }
+    }
+    if (slab_pages * PMM_PAGE_SIZE < cache->first_offset + cache->stride) return 0;
+    
+    cache->name = name;
+    cache->object_size = size;
+    cache->slab_pages = slab_pages;
+    cache->per_slab = (slab_pages * PMM_PAGE_SIZE - cache->first_offset) / cache->stride;
+    cache->ctor = ctor;
+    cache->lock = (spinlock_t)SPINLOCK_INIT;
+    cache->partial = cache->full = cache->empty = 0;
+    cache->empty_count = 0;
+    cache->slabs = cache->in_use = 0;
+    cache->allocs = cache->frees = 0;
+    
+    cache->next = 0;
+    *caches_tail = cache;
+    caches_tail = &cache->next;
+    return 1;
+}
+
+static kmem_cache_t* cache_create(const char* name, uint32_t size, uint32_t align,
+                                  void (*ctor)(void*), uint32_t slab_pages) {
+    kmem_cache_t* cache = kmem_cache_alloc(&cache_cache);
+    if (!cache) return 0;
+    
+    if (!cache_setup(cache, name, size, align, ctor, slab_pages)) {
+        kmem_cache_free(&cache_cache, cache);
+        return 0;
+    }
+    return cache;
+}
+
+void slab_init(void) {
+    caches = 0;
+    caches_tail = &caches;
+    cache_setup(&cache_cache, "kmem_cache", sizeof(kmem_cache_t), 0, 0, 0);
+    
+    for (int i = 0; i < KMALLOC_CLASSES; i++) {
+        kmalloc_caches[i] = cache_create(kmalloc_names[i], 1u << (KMALLOC_MIN_SHIFT + i), 16,
+                                         0, KMALLOC_CHUNK_PAGES);
+    }
+}
+
+kmem_cache_t* kmem_cache_create(const char* name, uint32_t size, uint32_t align,
+                                void (*ctor)(void* object)) {
+    return cache_create(name, size, align, ctor, 0);
+}
+
+static void slab_link(kmem_slab_t** list, kmem_slab_t* slab) {
+    slab->prev = 0;
+    slab->next = *list;
+    if (*list) (*list)->prev = slab;
+    *list = slab;
+}
+
+static void slab_unlink(kmem_slab_t** list, kmem_slab_t* slab) {
+    if (slab->prev) slab->prev->next = slab->next;
+    else *list = slab->next;
+    if (slab->next) slab->next->prev = slab->prev;
+}
+
+/* A new slab with every object constructed and on its free list */
+static kmem_slab_t* cache_grow(kmem_cache_t* cache) {
+    uint32_t base = pmm_alloc_pages(cache->slab_pages);
+    if (!base) return 0;
+    
+    kmem_slab_t* slab = (kmem_slab_t*)base;
+    slab->magic = KMEM_SLAB_MAGIC;
+    slab->cache = cache;
+    slab->free = 0;
+    slab->in_use = 0;
+    
+    // Chain from the top down so objects go out in address order
+    uint8_t* object = (uint8_t*)base + cache->first_offset + (cache->per_slab - 1) * cache->stride;
+    for (uint32_t i = 0; i < cache->per_slab; i++, object -= cache->stride) {
+        if (cache->ctor) cache->ctor(object);
+        *(void**)(object + cache->link_offset) = slab->free;
+        slab->free = object;
+    }
+    
+    cache->slabs++;
+    return slab;
+}
+
+void* kmem_cache_alloc(kmem_cache_t* cache) {
+    uint32_t flags = spin_lock_irqsave(&cache->lock);
+    kmem_slab_t* slab = cache->partial;
+    
+    if (!slab) {
+        slab = cache->empty;
+        if (slab) {
+            slab_unlink(&cache->empty, slab);
+            cache->empty_count--;
+        } else if (!(slab = cache_grow(cache))) {
+            spin_unlock_irqrestore(&cache->lock, flags);
+            return 0;
+        }
+        slab_link(&cache->partial, slab);
+    }
+    
+    uint8_t* object = slab->free;
+    slab->free = *(void**)(object + cache->link_offset);
+    if (++slab->in_use == cache->per_slab) {
+        slab_unlink(&cache->partial, slab);
+        slab_link(&cache->full, slab);
+    }
+    
+    cache->in_use++;
+    cache->allocs++;
+    spin_unlock_irqrestore(&cache->lock, flags);
+    return object;
+}
+
+void kmem_cache_free(kmem_cache_t* cache, void* object) {
+    if (!object) return;
+    
+    // Slabs are aligned to their size
+    kmem_slab_t* slab = (kmem_slab_t*)((uint32_t)object & ~(cache->slab_pages * PMM_PAGE_SIZE - 1));
+    if (slab->magic != KMEM_SLAB_MAGIC || slab->cache != cache) return;
+    
+    uint32_t flags = spin_lock_irqsave(&cache->lock);
+    *(void**)((uint8_t*)object + cache->link_offset) = slab->free;
+    slab->free = object;
+    
+    if (slab->in_use-- == cache->per_slab) {
+        slab_unlink(&cache->full, slab);
+        slab_link(&cache->partial, slab);
+    }
+    if (slab->in_use == 0) {
+        slab_unlink(&cache->partial, slab);
+        if (cache->empty_count < KMEM_EMPTY_KEEP) {
+            slab_link(&cache->empty, slab);
+            cache->empty_count++;
+        } else {
+            slab->magic = 0;
+            cache->slabs--;
+            pmm_free_pages((uint32_t)slab, cache->slab_pages);
+        }
+    }
+    
+    cache->in_use--;
+    cache->frees++;
+    spin_unlock_irqrestore(&cache->lock, flags);
+}
+
+void kmem_cache_stats(const kmem_cache_t* cache, kmem_cache_stats_t* stats) {
+    stats->name = cache->name;
+    stats->object_size = cache->object_size;
+    stats->objects_per_slab = cache->per_slab;
+    stats->slabs = cache->slabs;
+    stats->pages = cache->slabs * cache->slab_pages;
+    stats->objects_in_use = cache->in_use;
+    stats->allocs = cache->allocs;
+    stats->frees = cache->frees;
+}
+
+const kmem_cache_t* kmem_cache_next(const kmem_cache_t* cache) {
+    return cache ? cache->next : caches;
+}
+
+void* kmalloc(uint32_t size) {
+    if (!size) return 0;
+    
+    if (size <= (1u << KMALLOC_MAX_SHIFT)) {
+        uint32_t shift = size <= (1u << KMALLOC_MIN_SHIFT) ? KMALLOC_MIN_SHIFT : 32 - __builtin_clz(size - 1);
+        kmem_cache_t* cache = kmalloc_caches[shift - KMALLOC_MIN_SHIFT];
+        return cache ? kmem_cache_alloc(cache) : 0;
+    }
+    
+    // Whole pages, at least a chunk so the header sits at a chunk boundary
+    uint32_t pages = (size + KMALLOC_LARGE_OFFSET + PMM_PAGE_SIZE - 1) >> PMM_PAGE_SHIFT;
+    if (pages < KMALLOC_CHUNK_PAGES) pages = KMALLOC_CHUNK_PAGES;
+    
+    uint32_t base = pmm_alloc_pages(pages);
+    if (!base) return 0;
+    
+    kmem_large_t* large = (kmem_large_t*)base;
+    large->magic = KMEM_LARGE_MAGIC;
+    large->pages = pages;
+    return (uint8_t*)base + KMALLOC_LARGE_OFFSET;
+}
+
+void kfree(void* ptr) {
+    if (!ptr) return;
+    
+    uint32_t base = (uint32_t)ptr & ~(KMALLOC_CHUNK - 1);
+    kmem_slab_t* slab = (kmem_slab_t*)base;
+    kmem_large_t* large = (kmem_large_t*)base;
+    
+    if (slab->magic == KMEM_SLAB_MAGIC) {
+        kmem_cache_free(slab->cache, ptr);
+    } else if (large->magic == KMEM_LARGE_MAGIC && (uint32_t)ptr == base + KMALLOC_LARGE_OFFSET) {
+        large->magic = 0;
+        pmm_free_pages(base, large->pages);
+    }
+}
@@ -0,0 +1,170 @@
+#include "../include/smp.h"
+#include "../include/apic.h"
+#include "../include/cpu.h"
+#include "../include/field.h"
+#include "../include/gdt.h"
+#include "../include/idt.h"
+#include "../include/mem.h"
+#include "../include/paging.h"
+#include "../include/pmm.h"
+#include "../include/timer.h"
+
+#define AP_TRAMPOLINE_BASE  0x8000   // Same as ap_trampoline.S; conventional memory
+#define AP_STACK_PAGES      4
+
+#define INIT_DELAY_US       10000    // Intel MP spec B.4
+#define STARTUP_DELAY_US    200
+#define ONLINE_TIMEOUT_US   100000
+
+/* ap_trampoline.S */
+extern uint8_t ap_trampoline_start[];
+extern uint8_t ap_trampoline_end[];
+extern uint32_t ap_trampoline_stack;
+extern uint32_t ap_trampoline_entry;
+
+static cpu_t cpus[SMP_CPU_MAX];
+static volatile uint32_t cpu_count = 1;
+static volatile uint32_t ap_booting = 0;   // Index of the AP being started
+
+/* smp_call() in flight, and where each CPU parks the FPU state it interrupted */
+static void (*volatile call_fn)(void* arg) = 0;
+static void* volatile call_arg = 0;
+static volatile uint32_t call_done = 0;
+static volatile uint8_t call_busy = 0;
+static uint8_t call_fpu[SMP_CPU_MAX][512] __attribute__((aligned(16)));
+
+/* Busy wait on the TSC; smp_start() runs before interrupts are on */
+static void delay_us(uint32_t us) {
+    uint64_t until = timer_now_ns() + (uint64_t)us * 1000;
+    while (timer_now_ns() < until) asm volatile ("pause");
+}
+
+/* Give cpu its GDT segment and load it into %gs */
+static void cpu_bind(cpu_t* cpu) {
+    uint16_t selector = gdt_set_cpu_segment(cpu->index, (uint32_t)cpu, sizeof(cpu_t));
+    asm volatile ("movw %0, %%gs" : : "r"(selector) : "memory");
+}
+
+/* Where the trampoline's copy keeps a variable */
+static uint32_t* trampoline_slot(uint32_t* variable) {
+    return (uint32_t*)(AP_TRAMPOLINE_BASE + ((uint8_t*)variable - ap_trampoline_start));
+}
+
+/* First C code on an AP: the boot CPU's tables, its own local APIC and
+   run queues, then fields for good */
+static void __attribute__((noreturn)) ap_main(void) {
+    cpu_t* cpu = &cpus[ap_booting];
+    
+    gdt_load();
+    cpu_bind(cpu);
+    idt_load();
+    paging_init_ap();
+    apic_init_ap();
+    field_cpu_start();
+    timer_init_ap();
+    
+    cpu->online = 1;
+    field_cpu_run();
+}
+
+static void call_irq(registers_t* regs) {
+    (void)regs;
+    uint8_t* fpu = call_fpu[smp_cpu_index()];
+    uint8_t fxsr = cpu_has(CPU_FEATURE_FXSR);
+    
+    if (fxsr) asm volatile ("fxsave (%0)" : : "r"(fpu) : "memory");
+    else asm volatile ("fnsave (%0); fwait" : : "r"(fpu) : "memory");
+    
+    call_fn(call_arg);
+    
+    if (fxsr) asm volatile ("fxrstor (%0)" : : "r"(fpu) : "memory");
+    else asm volatile ("frstor (%0)" : : "r"(fpu) : "memory");
+    __atomic_fetch_add(&call_done, 1, __ATOMIC_RELEASE);
+}
+
+void smp_init(void) {
+    cpus[0].self = &cpus[0];
+    cpus[0].index = 0;
+    cpus[0].online = 1;
+    cpu_bind(&cpus[0]);
+}
+
+void smp_start(void) {
+    if (!apic_enabled() || timer_vector() != APIC_TIMER_VECTOR) return;
+    cpus[0].apic_id = apic_id();
+    
+    memcpy((void*)AP_TRAMPOLINE_BASE, ap_trampoline_start, ap_trampoline_end - ap_trampoline_start);
+    *trampoline_slot(&ap_trampoline_entry) = (uint32_t)ap_main;
+    interrupt_register(SMP_CALL_VECTOR, call_irq);
+    
+    // One AP at a time, in MADT order, so the trampoline's stack is never shared
+    for (uint32_t i = 0; i < apic_cpu_count() && cpu_count < SMP_CPU_MAX; i++) {
+        uint8_t id = apic_cpu_apic_id(i);
+        if (id == cpus[0].apic_id) continue;
+        
+        uint32_t stack = pmm_alloc_pages(AP_STACK_PAGES);
+        if (!stack) return;
+        
+        cpu_t* cpu = &cpus[cpu_count];
+        cpu->self = cpu;
+        cpu->index = cpu_count;
+        cpu->apic_id = id;
+        cpu->online = 0;
+        cpu->stack = stack;
+        ap_booting = cpu_count;
+        *trampoline_slot(&ap_trampoline_stack) = stack + AP_STACK_PAGES * PMM_PAGE_SIZE;
+        
+        // INIT, then a startup IPI, and a second one if the first was missed
+        apic_send_init(id);
+        delay_us(INIT_DELAY_US);
+        apic_send_startup(id, AP_TRAMPOLINE_BASE);
+        delay_us(STARTUP_DELAY_US);
+        if (!cpu->online) apic_send_startup(id, AP_TRAMPOLINE_BASE);
+        
+        uint64_t until = timer_now_ns() + (uint64_t)ONLINE_TIMEOUT_US * 1000;
+        while (!cpu->online && timer_now_ns() < until) asm volatile ("pause");
+        
+        // A CPU that is late may still come up on this slot and stack, so
+        // leave both to it and start no more
+        if (!cpu->online) return;
+        cpu_count++;
+    }
+}
+
+uint32_t smp_cpu_count(void) {
+    return cpu_count;
+}
+
+void smp_wake(uint32_t index) {
+    if (index < cpu_count && index != smp_cpu_index()) apic_send_ipi(cpus[index].apic_id, SMP_WAKE_VECTOR);
+}
+
+uint8_t smp_call(void (*fn)(void* arg), void* arg) {
+    uint32_t others = cpu_count - 1;
+    
+    // An AP would IPI itself with interrupts off and wait for itself; a
+    // nested call would overwrite the one in flight
+    if (call_busy || (others && smp_cpu_index() != 0)) return 0;
+    call_busy = 1;
+    
+    if (others) {
+        call_fn = fn;
+        call_arg = arg;
+        call_done = 0;
+        for (uint32_t i = 1; i <= others; i++) apic_send_ipi(cpus[i].apic_id, SMP_CALL_VECTOR);
+    }
+    
+    fn(arg);
+    while (__atomic_load_n(&call_done, __ATOMIC_ACQUIRE) < others) asm volatile ("pause");
+    call_busy = 0;
+    return 1;
+}
+
+void smp_stop_others(void) {
+    if (cpu_count == 1) return;   // %gs may not even be set up yet
+    
+    uint32_t self = smp_cpu_index();
+    for (uint32_t i = 0; i < cpu_count; i++) {
+        if (i != self) apic_send_nmi(cpus[i].apic_id);
+    }
+}
@@ -0,0 +1,279 @@
+#include "../include/timer.h"
+#include "../include/cpu.h"
+#include "../include/io.h"
+#include "../include/idt.h"
+#include "../include/apic.h"
+#include "../include/smp.h"
+
+#define PIT_CHANNEL0  0x40
+#define PIT_CHANNEL2  0x42
+#define PIT_COMMAND   0x43
+#define PIT_GATE      0x61       // Channel 2 gate (bit 0) and output (bit 5)
+
+/* Nanoseconds per PIT input clock, Q16 */
+#define PIT_NS_Q16    54925
+
+/* TSC calibration window: ~10 ms of PIT channel 2 */
+#define CALIBRATE_COUNT  11932
+#define CALIBRATE_SPINS  1000000
+
+/* Longest one-shot programmed at once; longer waits take several */
+#define ONESHOT_MAX_NS   100000000u
+
+static volatile uint64_t tick_count = 0;
+static volatile uint64_t tick_tsc = 0;   // TSC when the last tick was taken
+static uint32_t tick_ns = 0;             // Tick period
+static uint32_t tsc_khz = 0;
+static uint32_t tsc_ns_q24 = 0;          // Nanoseconds per TSC cycle, Q24
+
+/* One-shot mode: the local APIC timer is re-armed for every tick, or for
+   the idle deadline when nothing needs the ticks in between. Time is
+   read from the TSC alone. Each CPU has its own timer; the boot CPU's
+   counts the ticks. */
+static uint8_t oneshot = 0;
+static uint8_t tsc_deadline = 0;         // Armed with a TSC value, not a count
+static uint32_t apic_khz = 0;            // APIC timer input clock
+static uint64_t tsc_base = 0;
+static uint64_t next_tick_ns[SMP_CPU_MAX];
+
+static timer_frame_stats_t frame_stats;
+static uint64_t frame_start = 0;
+static uint64_t frame_deadline = 0;
+
+static void halt_until(uint64_t deadline_ns);
+static void (*idle_handler)(uint64_t deadline_ns) = halt_until;
+
+/* 64 / 32 bit division without libgcc; the quotient must fit 32 bits */
+static inline uint32_t udiv64_32(uint64_t n, uint32_t d) {
+    uint32_t q, r;
+    asm ("divl %4" : "=a"(q), "=d"(r) : "a"((uint32_t)n), "d"((uint32_t)(n >> 32)), "rm"(d));
+    (void)r;
+    return q;
+}
+
+/* Count TSC cycles (and APIC timer clocks, when asked) over a fixed PIT
+   channel 2 one-shot. Polls, so it works before interrupts are on.
+   Returns 0 if the channel never fires. */
+static uint32_t calibrate_tsc_khz(uint32_t* apic_clock_khz) {
+    uint8_t gate = inb(PIT_GATE);
+    outb(PIT_GATE, (gate & ~0x02) | 0x01);  // Speaker off, gate on
+    
+    outb(PIT_COMMAND, 0xB0);                // Channel 2, lo/hi byte, mode 0
+    outb(PIT_CHANNEL2, CALIBRATE_COUNT & 0xFF);
+    outb(PIT_CHANNEL2, CALIBRATE_COUNT >> 8);
+    
+    if (apic_clock_khz) apic_timer_arm(0xFFFFFFFFu);
+    uint64_t start = rdtsc();
+    uint32_t spins = 0;
+    while (!(inb(PIT_GATE) & 0x20)) {
+        if (++spins == CALIBRATE_SPINS) break;
+    }
+    uint64_t cycles = rdtsc() - start;
+    outb(PIT_GATE, gate);
+    
+    if (apic_clock_khz) {
+        uint32_t clocks = 0xFFFFFFFFu - apic_timer_current();
+        apic_timer_arm(0);
+        *apic_clock_khz = udiv64_32((uint64_t)clocks * PIT_FREQUENCY, CALIBRATE_COUNT * 1000);
+    }
+    if (spins == CALIBRATE_SPINS) return 0;
+    
+    // kHz = cycles * PIT_FREQUENCY / (CALIBRATE_COUNT * 1000)
+    return udiv64_32(cycles * PIT_FREQUENCY, CALIBRATE_COUNT * 1000);
+}
+
+/* Clock counts in ns at khz, rounded up so a one-shot never fires early */
+static inline uint32_t ns_to_clocks(uint32_t ns, uint32_t khz) {
+    return udiv64_32((uint64_t)ns * khz + 999999, 1000000);
+}
+
+/* Fire the one-shot at at_ns, or ONESHOT_MAX_NS from now if that is sooner */
+static void oneshot_arm(uint64_t at_ns) {
+    uint64_t now = timer_now_ns();
+    uint32_t delay = at_ns <= now ? 0 : at_ns - now > ONESHOT_MAX_NS ? ONESHOT_MAX_NS : (uint32_t)(at_ns - now);
+    
+    if (tsc_deadline) {
+        apic_timer_arm_deadline(rdtsc() + ns_to_clocks(delay, tsc_khz));
+    } else {
+        uint32_t clocks = ns_to_clocks(delay, apic_khz);
+        apic_timer_arm(clocks ? clocks : 1);   // 0 would stop it
+    }
+}
+
+void timer_init(uint32_t hz) {
+    uint32_t divisor = (PIT_FREQUENCY + hz / 2) / hz;
+    if (divisor == 0) divisor = 1;
+    if (divisor > 65535) divisor = 65535;
+    tick_ns = (divisor * PIT_NS_Q16) >> 16;
+    
+    // Interpolation needs at least 3.9 MHz for the Q24 scale to fit
+    if (cpu_has(CPU_FEATURE_TSC)) {
+        tsc_deadline = apic_timer_has_deadline();
+        if (apic_enabled()) apic_timer_setup(APIC_TIMER_VECTOR, 0);
+        tsc_khz = calibrate_tsc_khz(apic_enabled() && !tsc_deadline ? &apic_khz : 0);
+        if (tsc_khz > 3906) {
+            tsc_ns_q24 = udiv64_32(1000000ULL << 24, tsc_khz);
+        } else {
+            tsc_khz = 0;
+        }
+    }
+    tick_count = 0;
+    
+    // The APIC timer needs the TSC to keep time between its interrupts
+    oneshot = tsc_khz && (tsc_deadline || apic_khz);
+    if (oneshot) {
+        apic_timer_setup(APIC_TIMER_VECTOR, tsc_deadline);
+        tsc_base = rdtsc();
+        next_tick_ns[0] = tick_ns;
+        oneshot_arm(next_tick_ns[0]);
+        return;
+    }
+    
+    // Channel 0, lo/hi byte, mode 2 (rate generator)
+    outb(PIT_COMMAND, 0x34);
+    outb(PIT_CHANNEL0, divisor & 0xFF);
+    outb(PIT_CHANNEL0, divisor >> 8);
+    
+    if (tsc_khz) tick_tsc = rdtsc();
+    irq_unmask(0);
+}
+
+void timer_init_ap(void) {
+    if (!oneshot) return;
+    
+    uint32_t cpu = smp_cpu_index();
+    apic_timer_setup(APIC_TIMER_VECTOR, tsc_deadline);
+    next_tick_ns[cpu] = timer_now_ns() + tick_ns;
+    oneshot_arm(next_tick_ns[cpu]);
+}
+
+uint8_t timer_vector(void) {
+    return oneshot ? APIC_TIMER_VECTOR : IDT_IRQ_BASE;
+}
+
+void timer_tick(void) {
+    if (oneshot) {
+        // Every period that has passed, several after an idle sleep
+        uint32_t cpu = smp_cpu_index();
+        uint64_t now = timer_now_ns();
+        while (next_tick_ns[cpu] <= now) {
+            if (cpu == 0) tick_count++;
+            next_tick_ns[cpu] += tick_ns;
+        }
+        oneshot_arm(next_tick_ns[cpu]);
+        return;
+    }
+    
+    if (tsc_khz) tick_tsc = rdtsc();
+    tick_count++;
+}
+
+void timer_halt(uint64_t wake_ns) {
+    if (oneshot && wake_ns > next_tick_ns[smp_cpu_index()]) oneshot_arm(wake_ns);
+    
+    // sti takes effect after hlt starts, so no wakeup is lost
+    asm volatile ("sti; hlt");
+}
+
+uint64_t timer_ticks(void) {
+    uint32_t flags = irq_save();
+    uint64_t ticks = tick_count;
+    irq_restore(flags);
+    return ticks;
+}
+
+uint64_t timer_now_ns(void) {
+    if (oneshot) {
+        // Split so the product cannot overflow however long we run
+        uint64_t cycles = rdtsc() - tsc_base;
+        return (cycles >> 24) * tsc_ns_q24 + (((cycles & 0xFFFFFF) * tsc_ns_q24) >> 24);
+    }
+    
+    uint32_t flags = irq_save();
+    uint64_t ticks = tick_count;
+    uint64_t stamp = tick_tsc;
+    irq_restore(flags);
+    
+    uint64_t ns = ticks * tick_ns;
+    if (!tsc_khz) return ns;
+    
+    // Time since the tick, kept below one period so the clock never steps back
+    uint64_t cycles = rdtsc() - stamp;
+    if (cycles > 0xFFFFFFFFu) cycles = 0xFFFFFFFFu;
+    uint64_t since = (cycles * tsc_ns_q24) >> 24;
+    if (since >= tick_ns) since = tick_ns - 1;
+    
+    return ns + since;
+}
+
+uint32_t timer_tsc_khz(void) {
+    return tsc_khz;
+}
+
+/* Frame pacing */
+/* Every wakeup rechecks the deadline */
+static void halt_until(uint64_t deadline_ns) {
+    for (;;) {
+        cli();
+        if (timer_now_ns() >= deadline_ns) break;
+        timer_halt(deadline_ns);
+    }
+    sti();
+}
+
+void timer_set_idle_handler(void (*idle)(uint64_t deadline_ns)) {
+    idle_handler = idle ? idle : halt_until;
+}
+
+void timer_frame_init(uint32_t fps) {
+    frame_stats = (timer_frame_stats_t){0};
+    frame_stats.target_ns = 1000000000u / fps;
+    frame_stats.min_ns = 0xFFFFFFFFu;
+    
+    frame_start = timer_now_ns();
+    frame_deadline = frame_start;
+}
+
+fixed_t timer_frame_begin(void) {
+    uint64_t now = timer_now_ns();
+    uint64_t elapsed = now - frame_start;
+    frame_start = now;
+    
+    // Clamp before narrowing: a stall of over 4.29s would otherwise wrap
+    if (elapsed > TIMER_FRAME_MAX_DELTA_MS * 1000000u) elapsed = TIMER_FRAME_MAX_DELTA_MS * 1000000u;
+    uint32_t delta = (uint32_t)elapsed;
+    
+    if (frame_stats.frames > 0) {
+        frame_stats.last_ns = delta;
+        if (delta < frame_stats.min_ns) frame_stats.min_ns = delta;
+        if (delta > frame_stats.max_ns) frame_stats.max_ns = delta;
+        frame_stats.avg_ns = frame_stats.avg_ns
+            ? frame_stats.avg_ns - frame_stats.avg_ns / 16 + delta / 16
+            : delta;
+    } else {
+        delta = frame_stats.target_ns;  // No previous frame to measure against
+    }
+    frame_stats.frames++;
+    return FIXED_FROM_NS(delta);
+}
+
+void timer_frame_end(void) {
+    uint64_t now = timer_now_ns();
+    frame_stats.work_ns = (uint32_t)(now - frame_start);
+    frame_stats.idle_ns = 0;
+    
+    frame_deadline += frame_stats.target_ns;
+    if (now >= frame_deadline) {
+        frame_stats.late_frames++;
+        frame_deadline = now;
+        return;
+    }
+    
+    idle_handler(frame_deadline);
+    now = timer_now_ns();
+    frame_stats.idle_ns = (uint32_t)(now - frame_start) - frame_stats.work_ns;
+}
+
+const timer_frame_stats_t* timer_get_frame_stats(void) {
+    return &frame_stats;
+}
@@ -0,0 +1,129 @@
+#include "../include/trace.h"
+#include "../include/pmm.h"
+#include "../include/mem.h"
+#include "../include/timer.h"
+
+trace_ring_t* trace_rings = 0;
+volatile uint8_t trace_enabled = 0;
+
+static const char* const point_names[TRACE_POINTS] = {
+    "gui_update",
+    "gui_render",
+    "universe_render",
+    "irq",
+    "field_pick",
+    "pixels_pushed"
+};
+
+static uint32_t events_since_sync = TRACE_SYNC_EVENTS;   // Header goes out first
+static uint32_t next_ring = 0;                           // Round robin over CPUs
+
+void trace_init(void) {
+    if (!cpu_has(CPU_FEATURE_TSC)) return;
+    
+    if (!trace_rings) {
+        uint32_t bytes = SMP_CPU_MAX * sizeof(trace_ring_t);
+        trace_rings = (trace_ring_t*)pmm_alloc_pages((bytes + PMM_PAGE_SIZE - 1) >> PMM_PAGE_SHIFT);
+        if (!trace_rings) return;
+        memset(trace_rings, 0, bytes);
+    }
+    trace_enabled = 1;
+}
+
+void trace_enable(uint8_t on) {
+    trace_enabled = on && trace_rings;
+}
+
+static uint32_t header_size(void) {
+    uint32_t size = 10;
+    for (int i = 0; i < TRACE_POINTS; i++) {
+        const char* name = point_names[i];
+        uint32_t len = 0;
+        while (name[len]) len++;
+        size += 1 + len;
+    }
+    return size;
+}
+
+static uint8_t* put_u32(uint8_t* p, uint32_t value) {
+    p[0] = value;
+    p[1] = value >> 8;
+    p[2] = value >> 16;
+    p[3] = value >> 24;
+    return p + 4;
+}
+
+static uint32_t write_header(uint8_t* buf) {
+    uint8_t* p = put_u32(buf, TRACE_MAGIC);
+    *p++ = TRACE_VERSION;
+    *p++ = TRACE_POINTS;
+    p = put_u32(p, timer_tsc_khz());
+    
+    for (int i = 0; i < TRACE_POINTS; i++) {
+        const char* name = point_names[i];
+        uint8_t* len = p++;
+        while (*name) *p++ = *name++;
+        *len = p - len - 1;
+    }
+    return p - buf;
+}
+
+static void write_record(uint8_t* buf, const trace_event_t* event, uint8_t kind) {
+    buf[0] = kind;
+    buf[1] = event->cpu;
+    buf[2] = event->point;
+    buf[3] = event->point >> 8;
+    put_u32(buf + 4, event->arg);
+    put_u32(buf + 8, event->tsc);
+    put_u32(buf + 12, event->tsc >> 32);
+}
+
+/* Room for one more record, after the header when one is due */
+static uint8_t make_room(uint8_t* buf, uint32_t* used, uint32_t max) {
+    if (events_since_sync >= TRACE_SYNC_EVENTS) {
+        if (max - *used < header_size()) return 0;
+        *used += write_header(buf + *used);
+        events_since_sync = 0;
+    }
+    if (max - *used < sizeof(trace_event_t)) return 0;
+    events_since_sync++;
+    return 1;
+}
+
+/* Drain whole records; a slot still being written ends that ring's turn */
+uint32_t trace_read(uint8_t* buf, uint32_t max) {
+    uint32_t used = 0;
+    if (!trace_rings) return 0;
+    
+    uint32_t cpus = smp_cpu_count();
+    for (uint32_t n = 0; n < cpus; n++) {
+        trace_ring_t* ring = &trace_rings[next_ring];
+        uint32_t cpu = next_ring;
+        next_ring = (next_ring + 1) % cpus;
+        
+        uint32_t dropped = ring->dropped;
+        if (dropped != ring->dropped_sent) {
+            if (!make_room(buf, &used, max)) return used;
+            trace_event_t lost = { 0, cpu, 0, dropped - ring->dropped_sent, 0 };
+            write_record(buf + used, &lost, TRACE_DROPPED);
+            used += sizeof(trace_event_t);
+            ring->dropped_sent = dropped;
+        }
+        
+        uint32_t tail = ring->tail;
+        while (tail != ring->head) {
+            trace_event_t* event = &ring->events[tail & (TRACE_RING_SIZE - 1)];
+            uint8_t kind = event->kind;
+            if (!kind) break;
+            asm volatile ("" : : : "memory");   // Loads stay in order on x86
+            
+            if (!make_room(buf, &used, max)) return used;
+            write_record(buf + used, event, kind);
+            used += sizeof(trace_event_t);
+            
+            event->kind = 0;
+            ring->tail = ++tail;
+        }
+    }
+    return used;
+}
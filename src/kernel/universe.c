@@ -1,44 +1,79 @@
 #include "../include/universe.h"
 #include "../include/graphics.h"
+#include "../include/slab.h"
+#include "../include/trace.h"
 
 static universe_t anchor;
 
-/* Fast sine approximation using Taylor series */
-float universe_sin(float x) {
-    // Normalize to [-PI, PI]
-    const float PI = 3.14159265f;
-    while (x > PI) x -= 2 * PI;
-    while (x < -PI) x += 2 * PI;
-    
-    // Taylor series: sin(x) ≈ x - x³/6 + x⁵/120
-    float x2 = x * x;
-    float x3 = x2 * x;
-    float x5 = x3 * x2;
-    return x - (x3 / 6.0f) + (x5 / 120.0f);
-}
+/* Ring and core proportions, Q16.16 */
+#define PULSE_DEPTH      FIXED_FROM_RATIO(1, 10)   // Radius swings +-10%
+#define RING_COUNT       5
+#define RING_SPACING     15                        // Pixels between rings
+#define RING_PHASE_STEP  0x145F306Eu               // 0.5 rad between rings
+#define RING_ENERGY_MIX  FIXED_FROM_RATIO(3, 10)   // Up to 30% energy color
+#define CORE_RATIO       FIXED_FROM_RATIO(6, 10)
+#define FOCUS_RATIO      FIXED_FROM_RATIO(2, 10)
+
+/* Pulse frames for one radius/color key. frames[i] is valid once
+   ready[i] is set; its spans live in span_pool. */
+typedef struct universe_sprites {
+    int32_t radius;
+    color_t primary_color;
+    color_t energy_color;
+    uint32_t last_used;
+    uint8_t in_use;
+    uint8_t ready[UNIVERSE_SPRITE_STEPS];
+    graphics_sprite_t frames[UNIVERSE_SPRITE_STEPS];
+} universe_sprites_t;
+
+static universe_sprites_t sprite_slots[UNIVERSE_SPRITE_SLOTS];
+static graphics_span_t* span_pool = 0;       // UNIVERSE_SPRITE_SPANS
+static uint32_t span_pool_used = 0;
+static uint32_t sprite_clock = 0;
 
-float universe_cos(float x) {
-    const float PI = 3.14159265f;
-    return universe_sin(x + PI / 2.0f);
+/* Frames are rasterised here, then encoded into the pool */
+static uint32_t* sprite_scratch = 0;
+
+/* The pool and scratch surface come from the heap when the first frame
+   is built. Without them universes are rasterised directly. */
+static uint8_t sprite_storage(void) {
+    if (span_pool) return 1;
+    
+    span_pool = kmalloc(UNIVERSE_SPRITE_SPANS * sizeof(graphics_span_t));
+    sprite_scratch = kmalloc(UNIVERSE_SPRITE_MAX * UNIVERSE_SPRITE_MAX * sizeof(uint32_t));
+    if (span_pool && sprite_scratch) return 1;
+    
+    kfree(span_pool);
+    kfree(sprite_scratch);
+    span_pool = 0;
+    sprite_scratch = 0;
+    return 0;
 }
 
-void universe_init(universe_t* u, float x, float y, float radius, color_t color) {
+void universe_init(universe_t* u, fixed_t x, fixed_t y, fixed_t radius, color_t color) {
     u->x = x;
     u->y = y;
     u->radius = radius;
-    u->energy = 0.0f;
-    u->formation = 0.0f;
+    u->energy = 0;
+    u->formation = 0;
     u->state = UNIVERSE_STATE_FORMING;
     u->primary_color = color;
     u->energy_color = COLOR_ENERGY_CYAN;
+    u->sprites = 0;
 }
 
-void universe_update(universe_t* u, float delta_time) {
+void universe_set_colors(universe_t* u, color_t primary, color_t energy) {
+    u->primary_color = primary;
+    u->energy_color = energy;
+    u->sprites = 0;
+}
+
+void universe_update(universe_t* u, fixed_t delta_time) {
     switch (u->state) {
         case UNIVERSE_STATE_FORMING:
-            u->formation += delta_time * 0.5f;
-            if (u->formation >= 1.0f) {
-                u->formation = 1.0f;
+            u->formation += delta_time / 2;
+            if (u->formation >= FIXED_ONE) {
+                u->formation = FIXED_ONE;
                 u->state = UNIVERSE_STATE_STABLE;
             }
             break;
@@ -49,51 +84,166 @@ void universe_update(universe_t* u, float delta_time) {
             break;
             
         case UNIVERSE_STATE_PULSING:
-            u->energy += delta_time;
+            // One radian of phase per second; the angle wraps on its own
+            u->energy += fixed_to_angle(delta_time);
             break;
             
         case UNIVERSE_STATE_COLLAPSING:
-            u->formation -= delta_time * 2.0f;
-            if (u->formation <= 0.0f) {
-                u->formation = 0.0f;
+            u->formation -= delta_time * 2;
+            if (u->formation <= 0) {
+                u->formation = 0;
             }
             break;
     }
 }
 
-void universe_render(universe_t* u) {
-    if (u->formation <= 0.0f) return;
-    
-    // Calculate current radius with pulsing effect
-    float pulse = 1.0f;
-    if (u->state == UNIVERSE_STATE_PULSING) {
-        pulse = 1.0f + 0.1f * universe_sin(u->energy);
-    }
-    
-    float current_radius = u->radius * u->formation * pulse;
+static inline fixed_t pulse_at(angle_t phase) {
+    return FIXED_ONE + fixed_mul(PULSE_DEPTH, fixed_sin(phase));
+}
+
+/* Rings, core and focus point around (cx, cy) */
+static void rasterise(uint32_t cx, uint32_t cy, fixed_t radius, angle_t phase,
+                      color_t primary_color, color_t energy_color) {
+    // Draw concentric energy rings, fading outward
+    graphics_blend_mode_t previous_mode = graphics_get_blend_mode();
+    graphics_set_blend_mode(GRAPHICS_BLEND_ALPHA);
     
-    // Draw concentric energy rings
-    const int num_rings = 5;
-    for (int i = 0; i < num_rings; i++) {
-        float ring_radius = current_radius + (i * 15.0f);
-        float alpha = 1.0f - ((float)i / num_rings);
+    for (int i = 0; i < RING_COUNT; i++) {
+        uint32_t ring_radius = FIXED_TO_INT(radius + FIXED_FROM_INT(i * RING_SPACING));
+        uint32_t alpha = 255 * (RING_COUNT - i) / RING_COUNT;
         
         // Blend between primary and energy colors based on pulse
-        float energy_intensity = (universe_sin(u->energy + i * 0.5f) + 1.0f) * 0.5f;
-        color_t ring_color = graphics_blend_color(u->primary_color, u->energy_color, energy_intensity * 0.3f);
+        fixed_t energy_intensity = (fixed_sin(phase + i * RING_PHASE_STEP) + FIXED_ONE) / 2;
+        uint32_t weight = fixed_mul(energy_intensity, RING_ENERGY_MIX) >> (FIXED_SHIFT - 8);
+        color_t ring_color = graphics_mix_color(primary_color, energy_color, weight);
         
         // Adjust alpha
-        uint8_t a = (uint8_t)(alpha * 255.0f);
-        ring_color = (a << 24) | (ring_color & 0x00FFFFFF);
+        ring_color = (alpha << 24) | (ring_color & 0x00FFFFFF);
         
-        graphics_draw_circle((uint32_t)u->x, (uint32_t)u->y, (uint32_t)ring_radius, ring_color);
+        graphics_draw_circle(cx, cy, ring_radius, ring_color);
     }
     
+    graphics_set_blend_mode(previous_mode);
+    
     // Draw central core (solid)
-    graphics_fill_circle((uint32_t)u->x, (uint32_t)u->y, (uint32_t)(current_radius * 0.6f), u->primary_color);
+    graphics_fill_circle(cx, cy, FIXED_TO_INT(fixed_mul(radius, CORE_RATIO)), primary_color);
     
     // Draw bright center point (Observer focus)
-    graphics_fill_circle((uint32_t)u->x, (uint32_t)u->y, (uint32_t)(current_radius * 0.2f), COLOR_TEXT_WHITE);
+    graphics_fill_circle(cx, cy, FIXED_TO_INT(fixed_mul(radius, FOCUS_RATIO)), COLOR_TEXT_WHITE);
+}
+
+/* Drop every cached frame. Slots keep their keys, so universes holding
+   a slot rebuild frames lazily as they are drawn. Recorded draws may
+   still point at the spans, so they are rasterised first. */
+void universe_sprite_flush(void) {
+    graphics_flush();
+    for (int i = 0; i < UNIVERSE_SPRITE_SLOTS; i++) {
+        for (int s = 0; s < UNIVERSE_SPRITE_STEPS; s++) {
+            sprite_slots[i].ready[s] = 0;
+        }
+    }
+    span_pool_used = 0;
+}
+
+/* Slot holding this universe's key; the least recently used one is
+   re-keyed on a miss. Its old spans stay in the pool until a flush. */
+static universe_sprites_t* sprite_slot_for(universe_t* u) {
+    int32_t radius = FIXED_TO_INT(u->radius);
+    universe_sprites_t* slot = u->sprites;
+    
+    if (!slot || slot->radius != radius ||
+        slot->primary_color != u->primary_color || slot->energy_color != u->energy_color) {
+        slot = 0;
+        universe_sprites_t* victim = &sprite_slots[0];
+        
+        for (int i = 0; i < UNIVERSE_SPRITE_SLOTS; i++) {
+            universe_sprites_t* s = &sprite_slots[i];
+            if (s->in_use && s->radius == radius &&
+                s->primary_color == u->primary_color && s->energy_color == u->energy_color) {
+                slot = s;
+                break;
+            }
+            if (!victim->in_use) continue;
+            if (!s->in_use || s->last_used < victim->last_used) victim = s;
+        }
+        
+        if (!slot) {
+            slot = victim;
+            slot->radius = radius;
+            slot->primary_color = u->primary_color;
+            slot->energy_color = u->energy_color;
+            slot->in_use = 1;
+            for (int s = 0; s < UNIVERSE_SPRITE_STEPS; s++) slot->ready[s] = 0;
+        }
+        u->sprites = slot;
+    }
+    
+    slot->last_used = ++sprite_clock;
+    return slot;
+}
+
+/* Frame for one pulse step, rasterised and encoded on first use.
+   Returns 0 when it can't be cached and must be drawn directly. */
+static const graphics_sprite_t* sprite_frame(universe_sprites_t* slot, uint32_t step) {
+    graphics_sprite_t* frame = &slot->frames[step];
+    if (slot->ready[step]) return frame;
+    if (!sprite_storage()) return 0;
+    
+    angle_t phase = step << (32 - UNIVERSE_SPRITE_STEP_BITS);
+    fixed_t radius = fixed_mul(FIXED_FROM_INT(slot->radius), pulse_at(phase));
+    int32_t half = FIXED_TO_INT(radius) + (RING_COUNT - 1) * RING_SPACING + 1;
+    uint32_t size = 2 * half + 1;
+    if (size > UNIVERSE_SPRITE_MAX) return 0;
+    
+    graphics_surface_t surface = { sprite_scratch, size, size, size };
+    graphics_set_target(&surface);
+    graphics_clear(COLOR_TRANSPARENT);
+    rasterise(half, half, radius, phase, slot->primary_color, slot->energy_color);
+    graphics_set_target(0);
+    
+    // A full pool is emptied once; a frame that still doesn't fit is not cached
+    for (int attempt = 0; attempt < 2; attempt++) {
+        if (graphics_sprite_encode(frame, &surface, half, half, span_pool + span_pool_used,
+                                   UNIVERSE_SPRITE_SPANS - span_pool_used)) {
+            span_pool_used += frame->span_count;
+            slot->ready[step] = 1;
+            return frame;
+        }
+        if (span_pool_used == 0) break;
+        universe_sprite_flush();
+    }
+    return 0;
+}
+
+void universe_render(universe_t* u) {
+    if (u->formation <= 0 || !graphics_is_available()) return;
+    
+    trace_begin(TRACE_UNIVERSE_RENDER, (uint32_t)u);
+    uint32_t cx = FIXED_TO_INT(u->x);
+    uint32_t cy = FIXED_TO_INT(u->y);
+    
+    // Fully formed and pulsing: blit the frame for the nearest pulse step
+    if (u->state == UNIVERSE_STATE_PULSING && u->formation == FIXED_ONE) {
+        universe_sprites_t* slot = sprite_slot_for(u);
+        uint32_t step = (u->energy + (1u << (31 - UNIVERSE_SPRITE_STEP_BITS)))
+                        >> (32 - UNIVERSE_SPRITE_STEP_BITS);
+        const graphics_sprite_t* frame = sprite_frame(slot, step);
+        if (frame) {
+            graphics_sprite_draw(frame, cx, cy);
+            trace_end(TRACE_UNIVERSE_RENDER, (uint32_t)u);
+            return;
+        }
+    }
+    
+    // Forming, collapsing or too large to cache: rasterise in place
+    fixed_t pulse = FIXED_ONE;
+    if (u->state == UNIVERSE_STATE_PULSING) {
+        pulse = pulse_at(u->energy);
+    }
+    
+    fixed_t current_radius = fixed_mul(fixed_mul(u->radius, u->formation), pulse);
+    rasterise(cx, cy, current_radius, u->energy, u->primary_color, u->energy_color);
+    trace_end(TRACE_UNIVERSE_RENDER, (uint32_t)u);
 }
 
 /* Anchor Universe (Desktop) Implementation */
@@ -101,10 +251,10 @@ void anchor_universe_init(void) {
     uint32_t cx = graphics_get_width() / 2;
     uint32_t cy = graphics_get_height() / 2;
     
-    universe_init(&anchor, (float)cx, (float)cy, 60.0f, COLOR_UNIVERSE_BLUE);
+    universe_init(&anchor, FIXED_FROM_INT(cx), FIXED_FROM_INT(cy), FIXED_FROM_INT(60), COLOR_UNIVERSE_BLUE);
 }
 
-void anchor_universe_update(float delta_time) {
+void anchor_universe_update(fixed_t delta_time) {
     universe_update(&anchor, delta_time);
 }
 
@@ -0,0 +1,79 @@
+import sys
+import struct
+import subprocess
+
+# Write the kernel's function symbols into the .ksyms section reserved by
+# linker.ld (format in src/include/ksyms.h). Runs after objcopy:
+#
+#   python tools/embed_symbols.py kernel.pe paradox.bin
+#
+# The section's file offset in the flat binary is its address less
+# _kernel_start, where objcopy starts the image.
+
+MAGIC = 0x4D59534B   # "KSYM"
+MARKERS = ('_kernel_start', '_etext', '_ksyms', '_ksyms_end')
+
+def read_symbols(image):
+    out = subprocess.check_output(['nm', '-n', image]).decode('ascii', 'replace')
+    symbols = {}
+    functions = []
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) != 3:
+            continue
+        addr, kind, name = int(parts[0], 16), parts[1], parts[2]
+        symbols[name] = addr
+        if kind in 'Tt':
+            functions.append((addr, name))
+    return symbols, functions
+
+def c_name(name):
+    # The toolchain prefixes C symbols with an underscore
+    return name[1:] if name.startswith('_') else name
+
+def build_table(functions, text_start, text_end):
+    entries = []
+    seen = set()
+    for addr, name in functions:
+        if not text_start <= addr < text_end or addr in seen:
+            continue
+        if name in MARKERS or name.startswith('.') or name.startswith('__'):
+            continue
+        seen.add(addr)
+        entries.append((addr, c_name(name)))
+    entries.append((text_end, ''))   # End of .text: nothing past it matches
+
+    strings = bytearray()
+    names_base = 8 + 8 * len(entries)
+    table = bytearray(struct.pack('<II', MAGIC, len(entries)))
+    for addr, name in entries:
+        table += struct.pack('<II', addr, names_base + len(strings))
+        strings += name.encode('ascii', 'replace') + b'\0'
+    return bytes(table + strings), len(entries) - 1
+
+def main():
+    if len(sys.argv) != 3:
+        print('usage: embed_symbols.py kernel.pe paradox.bin')
+        sys.exit(1)
+
+    symbols, functions = read_symbols(sys.argv[1])
+    try:
+        base = symbols['_kernel_start']
+        start, end = symbols['_ksyms'], symbols['_ksyms_end']
+        text_end = symbols['_etext']
+    except KeyError as e:
+        print('embed_symbols: %s not in %s (linker.ld out of date?)' % (e, sys.argv[1]))
+        sys.exit(1)
+
+    blob, count = build_table(functions, base, text_end)
+    if len(blob) > end - start:
+        print('embed_symbols: table is %d bytes, .ksyms holds %d' % (len(blob), end - start))
+        sys.exit(1)
+
+    with open(sys.argv[2], 'r+b') as f:
+        f.seek(start - base)
+        f.write(blob)
+    print('embed_symbols: %d functions, %d bytes' % (count, len(blob)))
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,436 @@
+#include "host.h"
+#include "../../src/include/graphics.h"
+#include "../../src/include/pixel.h"
+#include "../../src/include/cpu.h"
+#include "../../src/include/mem.h"
+#include "../../src/include/gui.h"
+#include "../../src/include/hud.h"
+#include "../../src/include/universe.h"
+#include "../../src/include/field.h"
+#include "../../src/include/timer.h"
+#include "../../src/include/trace.h"
+
+/* Host benchmark and golden-image check
+   graphics.c, universe.c, gui.c and field.c built with the kernel's own
+   flags as a Linux program, drawing into a framebuffer in plain memory.
+
+     hostbench bench    ns/pixel per primitive, frame time per screen,
+                        scheduler picks/sec, cycles per trace event
+     hostbench golden   framebuffer checksums of fixed scenes, each drawn
+                        with every pixel kernel set and framebuffer depth
+     hostbench trace    a trace capture of desktop frames on stdout, in
+                        the COM1 stream format (tools/trace2json.py)
+
+   `make golden` diffs the second against golden.txt: an optimisation
+   that changes a single pixel shows up there. */
+#define SCREEN_WIDTH   1024
+#define SCREEN_HEIGHT  768
+#define SCREEN_PITCH   (SCREEN_WIDTH * 4 + 64)   // Padded, as real modes often are
+
+#define FRAME_DELTA    FIXED_FROM_RATIO(1, GUI_TARGET_FPS)
+
+static uint8_t* framebuffer = 0;
+static uint8_t screen_bpp = 32;
+
+/* Kernel sets to check goldens with: pixel_init()'s pick, then scalar */
+typedef enum {
+    KERNELS_NATIVE,
+    KERNELS_SCALAR
+} kernel_set_t;
+
+static void screen_init(uint8_t bpp, kernel_set_t kernels) {
+    screen_bpp = bpp;
+    graphics_init((uint32_t)framebuffer, SCREEN_WIDTH, SCREEN_HEIGHT, SCREEN_PITCH, bpp);
+    
+    if (kernels == KERNELS_SCALAR) {
+        pixel_ops.fill = pixel_fill_scalar;
+        pixel_ops.blit = pixel_blit_scalar;
+        pixel_ops.stream = pixel_blit_scalar;
+        pixel_ops.blend = pixel_blend_scalar;
+        pixel_ops.blend_solid = pixel_blend_solid_scalar;
+    }
+    
+    // Cached sprites would carry pixels over from the last kernel set
+    universe_sprite_flush();
+}
+
+/* FNV-1a over the visible bytes of every framebuffer row */
+static uint32_t screen_checksum(void) {
+    uint32_t bytes = SCREEN_WIDTH * ((screen_bpp + 7) / 8);
+    uint32_t hash = 2166136261u;
+    
+    for (uint32_t y = 0; y < SCREEN_HEIGHT; y++) {
+        const uint8_t* row = framebuffer + y * SCREEN_PITCH;
+        for (uint32_t i = 0; i < bytes; i++) {
+            hash = (hash ^ row[i]) * 16777619u;
+        }
+    }
+    return hash;
+}
+
+/* Golden scenes */
+
+static void scene_primitives(void) {
+    graphics_clear(COLOR_SPACE_DEEP);
+    
+    graphics_fill_rect(40, 40, 300, 200, COLOR_UNIVERSE_BLUE);
+    graphics_draw_rect(30, 30, 320, 220, COLOR_TEXT_WHITE);
+    graphics_fill_rect(SCREEN_WIDTH - 50, SCREEN_HEIGHT - 50, 100, 100, COLOR_FIELD_PURPLE);   // Off the corner
+    
+    graphics_set_blend_mode(GRAPHICS_BLEND_ALPHA);
+    graphics_fill_rect(200, 120, 300, 200, 0x80FF4020);
+    graphics_fill_circle(520, 300, 90, 0x6000FFFF);
+    graphics_draw_circle(520, 300, 120, 0xA0FFFFFF);
+    graphics_set_blend_mode(GRAPHICS_BLEND_NONE);
+    
+    graphics_fill_circle(10, 400, 60, COLOR_ENERGY_CYAN);    // Clipped on the left
+    graphics_draw_circle(800, 200, 75, COLOR_TEXT_GRAY);
+    graphics_draw_line(0, 0, SCREEN_WIDTH - 1, SCREEN_HEIGHT - 1, COLOR_TEXT_WHITE);
+    graphics_draw_line(SCREEN_WIDTH - 1, 10, 0, 600, COLOR_ENERGY_CYAN);
+    graphics_draw_line(100, 700, 900, 700, COLOR_TEXT_WHITE);
+    graphics_draw_line(700, 100, 700, 500, COLOR_TEXT_WHITE);
+    
+    graphics_draw_char(60, 500, 'P', COLOR_TEXT_WHITE);
+    graphics_draw_string(60, 520, "ParadoxOS\nhost golden", COLOR_TEXT_GRAY);
+    graphics_draw_string_centered(600, "=== GOLDEN IMAGE ===", COLOR_TEXT_WHITE);
+    
+    graphics_text_run_t run;
+    graphics_text_run_init(&run, SCREEN_WIDTH - 120, 740, "Clipped text run at the edge");
+    graphics_text_run_draw(&run, COLOR_ENERGY_CYAN);
+    
+    graphics_present();
+}
+
+/* frames of the GUI in state, from a fresh gui_init() */
+static void scene_gui(gui_state_t state, uint32_t frames) {
+    gui_init();
+    gui_set_state(state);
+    for (uint32_t i = 0; i < frames; i++) {
+        gui_update(FRAME_DELTA);
+        gui_render();
+    }
+}
+
+typedef struct {
+    const char* name;
+    gui_state_t state;
+    uint32_t frames;             // 0: scene_primitives()
+    uint8_t all_depths;          // Also checked at 24, 16 and 15bpp
+} golden_scene_t;
+
+static const golden_scene_t golden_scenes[] = {
+    { "primitives",         GUI_STATE_WELCOME,      0,   1 },
+    { "welcome/1",          GUI_STATE_WELCOME,      1,   0 },
+    { "welcome/45",         GUI_STATE_WELCOME,      45,  0 },
+    { "welcome/180",        GUI_STATE_WELCOME,      180, 1 },
+    { "registration/60",    GUI_STATE_REGISTRATION, 60,  0 },
+    { "desktop/60",         GUI_STATE_DESKTOP,      60,  1 },
+};
+
+static uint32_t golden_run(const golden_scene_t* scene, uint8_t bpp, kernel_set_t kernels) {
+    screen_init(bpp, kernels);
+    if (scene->frames) scene_gui(scene->state, scene->frames);
+    else scene_primitives();
+    return screen_checksum();
+}
+
+/* One line per scene and depth. Every kernel set has to agree; when
+   they don't, both checksums are printed and the diff fails. */
+static int golden(void) {
+    static const uint8_t depths[] = { 32, 24, 16, 15 };
+    int status = 0;
+    
+    for (uint32_t i = 0; i < sizeof(golden_scenes) / sizeof(golden_scenes[0]); i++) {
+        const golden_scene_t* scene = &golden_scenes[i];
+        uint32_t depth_count = scene->all_depths ? sizeof(depths) : 1;
+        
+        for (uint32_t d = 0; d < depth_count; d++) {
+            uint32_t native = golden_run(scene, depths[d], KERNELS_NATIVE);
+            uint32_t scalar = golden_run(scene, depths[d], KERNELS_SCALAR);
+            
+            host_write(scene->name);
+            host_write(" ");
+            host_write_u32(depths[d]);
+            host_write("bpp ");
+            host_write_hex(native);
+            if (native != scalar) {
+                host_write(" scalar ");
+                host_write_hex(scalar);
+                status = 1;
+            }
+            host_write("\n");
+        }
+    }
+    return status;
+}
+
+/* Benchmarks */
+
+static void report(const char* name, uint64_t value_milli, const char* unit) {
+    host_write("  ");
+    host_write(name);
+    uint32_t len = 0;
+    while (name[len]) len++;
+    while (len++ < 26) host_write(" ");
+    host_write_milli(value_milli);
+    host_write(" ");
+    host_write(unit);
+    host_write("\n");
+}
+
+/* Nanoseconds per pixel, three decimals */
+static void report_per_pixel(const char* name, uint64_t ns, uint64_t pixels) {
+    report(name, ns * 1000 / pixels, "ns/pixel");
+}
+
+#define BENCH_CLEARS   200
+#define BENCH_RECTS    20000
+#define BENCH_RECT     128
+#define BENCH_CIRCLES  20000
+#define BENCH_RADIUS   64
+#define BENCH_CHARS    200000
+#define BENCH_STRINGS  4000
+
+static const char bench_text[] = "The quick brown fox jumps over the lazy dog 0123456789 ~!@#$%^&*";
+
+static void bench_primitives(void) {
+    uint64_t start, ns;
+    
+    host_write("primitives (");
+    host_write(pixel_simd_enabled() ? "sse2" : "scalar");
+    host_write(" kernels)\n");
+    
+    // Alternating colors, so every clear repaints the whole frame
+    start = host_clock_ns();
+    for (uint32_t i = 0; i < BENCH_CLEARS; i++) {
+        graphics_clear(i & 1 ? COLOR_SPACE_DEEP : COLOR_SPACE_DARK);
+        graphics_flush();
+    }
+    ns = host_clock_ns() - start;
+    report_per_pixel("clear", ns, (uint64_t)BENCH_CLEARS * SCREEN_WIDTH * SCREEN_HEIGHT);
+    graphics_present();
+    
+    start = host_clock_ns();
+    for (uint32_t i = 0; i < BENCH_RECTS; i++) {
+        graphics_fill_rect(i * 37 % (SCREEN_WIDTH - BENCH_RECT), i * 53 % (SCREEN_HEIGHT - BENCH_RECT),
+                           BENCH_RECT, BENCH_RECT, 0xFF000000 | (i * 2654435761u >> 8));
+    }
+    graphics_flush();
+    ns = host_clock_ns() - start;
+    report_per_pixel("fill_rect", ns, (uint64_t)BENCH_RECTS * BENCH_RECT * BENCH_RECT);
+    graphics_present();
+    
+    graphics_set_blend_mode(GRAPHICS_BLEND_ALPHA);
+    start = host_clock_ns();
+    for (uint32_t i = 0; i < BENCH_RECTS; i++) {
+        graphics_fill_rect(i * 37 % (SCREEN_WIDTH - BENCH_RECT), i * 53 % (SCREEN_HEIGHT - BENCH_RECT),
+                           BENCH_RECT, BENCH_RECT, 0x80000000 | (i * 2654435761u >> 8));
+    }
+    graphics_flush();
+    ns = host_clock_ns() - start;
+    graphics_set_blend_mode(GRAPHICS_BLEND_NONE);
+    report_per_pixel("fill_rect (blend)", ns, (uint64_t)BENCH_RECTS * BENCH_RECT * BENCH_RECT);
+    graphics_present();
+    
+    start = host_clock_ns();
+    for (uint32_t i = 0; i < BENCH_CIRCLES; i++) {
+        graphics_fill_circle(BENCH_RADIUS + i * 37 % (SCREEN_WIDTH - 2 * BENCH_RADIUS),
+                             BENCH_RADIUS + i * 53 % (SCREEN_HEIGHT - 2 * BENCH_RADIUS),
+                             BENCH_RADIUS, COLOR_UNIVERSE_BLUE);
+    }
+    graphics_flush();
+    ns = host_clock_ns() - start;
+    report_per_pixel("fill_circle", ns, (uint64_t)BENCH_CIRCLES * 355 * BENCH_RADIUS * BENCH_RADIUS / 113);
+    graphics_present();
+    
+    // Glyph cells, not lit pixels: what a line of text covers
+    start = host_clock_ns();
+    for (uint32_t i = 0; i < BENCH_CHARS; i++) {
+        uint32_t cell = i % ((SCREEN_WIDTH / 8) * (SCREEN_HEIGHT / 10));
+        graphics_draw_char(cell % (SCREEN_WIDTH / 8) * 8, cell / (SCREEN_WIDTH / 8) * 10,
+                           32 + i % 95, COLOR_TEXT_WHITE);
+    }
+    graphics_flush();
+    ns = host_clock_ns() - start;
+    report_per_pixel("draw_char", ns, (uint64_t)BENCH_CHARS * 64);
+    graphics_present();
+    
+    uint32_t length = sizeof(bench_text) - 1;
+    start = host_clock_ns();
+    for (uint32_t i = 0; i < BENCH_STRINGS; i++) {
+        graphics_draw_string(i % 64, i % (SCREEN_HEIGHT / 10) * 10, bench_text, COLOR_TEXT_GRAY);
+    }
+    graphics_flush();
+    ns = host_clock_ns() - start;
+    report_per_pixel("draw_string", ns, (uint64_t)BENCH_STRINGS * length * 64);
+    graphics_present();
+}
+
+#define BENCH_WARMUP_FRAMES  120
+#define BENCH_FRAMES         600
+
+static void bench_screen(const char* name, gui_state_t state) {
+    gui_init();
+    gui_set_state(state);
+    for (uint32_t i = 0; i < BENCH_WARMUP_FRAMES; i++) {
+        gui_update(FRAME_DELTA);
+        gui_render();
+    }
+    
+    // Render and present only; the update is not timed
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+        gui_update(FRAME_DELTA);
+        uint64_t start = host_clock_ns();
+        gui_render();
+        total += host_clock_ns() - start;
+    }
+    report(name, total / BENCH_FRAMES, "us/frame");
+}
+
+#define BENCH_FIELDS        8
+#define BENCH_FIELD_YIELDS  50000
+
+static volatile uint32_t fields_done = 0;
+static volatile uint64_t fields_end_ns = 0;
+
+static void bench_field(void) {
+    for (uint32_t i = 0; i < BENCH_FIELD_YIELDS; i++) {
+        field_update_dynamics();
+    }
+    if (++fields_done == BENCH_FIELDS) fields_end_ns = host_clock_ns();
+}
+
+/* Equal energies, so every pick switches to another field */
+static void bench_fields(void) {
+    init_cognitive_fields();
+    for (uint32_t i = 0; i < BENCH_FIELDS; i++) {
+        create_excitation("bench", bench_field, 10);
+    }
+    
+    uint64_t start = host_clock_ns();
+    while (fields_done < BENCH_FIELDS) {
+        field_idle_until(timer_now_ns() + 1000000);
+    }
+    uint64_t ns = fields_end_ns - start;
+    uint64_t picks = (uint64_t)BENCH_FIELDS * BENCH_FIELD_YIELDS;
+    
+    host_write("scheduler\n");
+    report("field_update_dynamics", picks * 1000000000000ull / ns, "picks/sec");
+}
+
+#define BENCH_TRACE_EVENTS  (1u << 20)
+
+/* Recording only: the ring is drained between batches, off the clock */
+static void bench_trace(void) {
+    static uint8_t sink[TRACE_RING_SIZE * sizeof(trace_event_t)];
+    uint64_t cycles = 0;
+    
+    trace_init();
+    for (uint32_t done = 0; done < BENCH_TRACE_EVENTS; done += TRACE_RING_SIZE / 2) {
+        uint64_t start = rdtsc();
+        for (uint32_t i = 0; i < TRACE_RING_SIZE / 4; i++) {
+            trace_begin(TRACE_GUI_RENDER, i);
+            trace_end(TRACE_GUI_RENDER, i);
+        }
+        cycles += rdtsc() - start;
+        while (trace_read(sink, sizeof(sink))) {}
+    }
+    trace_enable(0);
+    
+    host_write("trace\n");
+    report("trace_event", cycles * 1000 / BENCH_TRACE_EVENTS, "cycles/event");
+}
+
+#define BENCH_MEM_BYTES  (256u << 20)   // Moved per size
+
+typedef struct {
+    uint32_t size;
+    const char* copy;
+    const char* fill;
+} bench_mem_t;
+
+/* One size per class in mem.h, the largest a whole back buffer */
+static const bench_mem_t bench_mem[] = {
+    { 24,                           "memcpy 24B",     "memset 24B" },
+    { 256,                          "memcpy 256B",    "memset 256B" },
+    { 16384,                        "memcpy 16KB",    "memset 16KB" },
+    { SCREEN_PITCH * SCREEN_HEIGHT, "memcpy screen",  "memset screen" },
+};
+
+static void bench_memory(void) {
+    uint32_t largest = SCREEN_PITCH * SCREEN_HEIGHT;
+    uint8_t* src = host_map(largest);
+    uint8_t* dst = host_map(largest);
+    if (!src || !dst) return;
+    
+    host_write(mem_streaming() ? "memory (movnti from 256KB)\n" : "memory (rep)\n");
+    for (uint32_t i = 0; i < sizeof(bench_mem) / sizeof(bench_mem[0]); i++) {
+        uint32_t size = bench_mem[i].size;
+        uint32_t rounds = BENCH_MEM_BYTES / size;
+        
+        uint64_t start = host_clock_ns();
+        for (uint32_t r = 0; r < rounds; r++) memcpy(dst, src, size);
+        uint64_t ns = host_clock_ns() - start;
+        report(bench_mem[i].copy, (uint64_t)rounds * size * 1000000 / ns, "MB/s");
+        
+        start = host_clock_ns();
+        for (uint32_t r = 0; r < rounds; r++) memset(dst, r, size);
+        ns = host_clock_ns() - start;
+        report(bench_mem[i].fill, (uint64_t)rounds * size * 1000000 / ns, "MB/s");
+    }
+}
+
+static int bench(void) {
+    screen_init(32, KERNELS_NATIVE);
+    bench_primitives();
+    
+    host_write("screens (render + present)\n");
+    bench_screen("gui_welcome_render", GUI_STATE_WELCOME);
+    bench_screen("gui_registration_render", GUI_STATE_REGISTRATION);
+    bench_screen("gui_desktop_render", GUI_STATE_DESKTOP);
+    hud_toggle();
+    bench_screen("gui_desktop_render + HUD", GUI_STATE_DESKTOP);
+    hud_toggle();
+    
+    bench_fields();
+    bench_trace();
+    bench_memory();
+    return 0;
+}
+
+#define TRACE_FRAMES  30
+
+static int trace_capture(void) {
+    static uint8_t buf[4096];
+    
+    screen_init(32, KERNELS_NATIVE);
+    trace_init();
+    gui_init();
+    gui_set_state(GUI_STATE_DESKTOP);
+    for (uint32_t i = 0; i < TRACE_FRAMES; i++) {
+        gui_update(FRAME_DELTA);
+        gui_render();
+        
+        uint32_t n;
+        while ((n = trace_read(buf, sizeof(buf)))) host_write_bytes(buf, n);
+    }
+    return 0;
+}
+
+int host_main(int argc, char** argv) {
+    framebuffer = host_map(SCREEN_PITCH * SCREEN_HEIGHT);
+    if (!framebuffer) {
+        host_write("hostbench: no memory for the framebuffer\n");
+        return 1;
+    }
+    cpu_detect();
+    mem_init();
+    
+    if (argc < 2 || host_streq(argv[1], "bench")) return bench();
+    if (host_streq(argv[1], "golden")) return golden();
+    if (host_streq(argv[1], "trace")) return trace_capture();
+    
+    host_write("usage: hostbench [bench|golden|trace]\n");
+    return 2;
+}
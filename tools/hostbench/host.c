@@ -0,0 +1,180 @@
+#include "host.h"
+#include "../../src/include/smp.h"
+
+#define SYS_EXIT            1
+#define SYS_WRITE           4
+#define SYS_MMAP2           192
+#define SYS_SET_THREAD_AREA 243
+#define SYS_CLOCK_GETTIME   265
+
+#define CLOCK_MONOTONIC     1
+#define PROT_READ_WRITE     3
+#define MAP_PRIVATE_ANON    0x22
+
+static inline int32_t syscall3(uint32_t nr, uint32_t a, uint32_t b, uint32_t c) {
+    int32_t ret;
+    asm volatile ("int $0x80" : "=a"(ret) : "a"(nr), "b"(a), "c"(b), "d"(c) : "memory");
+    return ret;
+}
+
+static inline int32_t syscall6(uint32_t nr, uint32_t a, uint32_t b, uint32_t c,
+                               uint32_t d, uint32_t e, uint32_t f) {
+    // %ebp can't be named as an operand: swap it in around the call
+    uint32_t args[2] = { a, f };
+    uint32_t* argp = args;
+    int32_t ret;
+    asm volatile ("pushl %%ebp\n\t"
+                  "movl 4(%%ebx), %%ebp\n\t"
+                  "movl (%%ebx), %%ebx\n\t"
+                  "int $0x80\n\t"
+                  "popl %%ebp"
+                  : "=a"(ret), "+b"(argp)
+                  : "a"(nr), "c"(b), "d"(c), "S"(d), "D"(e)
+                  : "memory");
+    return ret;
+}
+
+void host_write_bytes(const void* data, uint32_t len) {
+    while (len) {
+        int32_t n = syscall3(SYS_WRITE, 1, (uint32_t)data, len);
+        if (n <= 0) return;
+        data = (const uint8_t*)data + n;
+        len -= n;
+    }
+}
+
+void host_write(const char* str) {
+    uint32_t len = 0;
+    while (str[len]) len++;
+    host_write_bytes(str, len);
+}
+
+void host_write_u64(uint64_t value) {
+    char buf[24];
+    int i = sizeof(buf) - 1;
+    buf[i] = 0;
+    do {
+        buf[--i] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    host_write(&buf[i]);
+}
+
+void host_write_u32(uint32_t value) {
+    host_write_u64(value);
+}
+
+void host_write_hex(uint32_t value) {
+    char buf[9];
+    for (int i = 7; i >= 0; i--) {
+        buf[i] = "0123456789abcdef"[value & 0xF];
+        value >>= 4;
+    }
+    buf[8] = 0;
+    host_write(buf);
+}
+
+void host_write_milli(uint64_t milli) {
+    uint32_t frac = milli % 1000;
+    char buf[5] = { '.', '0' + frac / 100, '0' + frac / 10 % 10, '0' + frac % 10, 0 };
+    host_write_u64(milli / 1000);
+    host_write(buf);
+}
+
+void host_exit(int status) {
+    for (;;) syscall3(SYS_EXIT, status, 0, 0);
+}
+
+uint64_t host_clock_ns(void) {
+    struct { int32_t sec, nsec; } ts;
+    syscall3(SYS_CLOCK_GETTIME, CLOCK_MONOTONIC, (uint32_t)&ts, 0);
+    return (uint64_t)(uint32_t)ts.sec * 1000000000u + (uint32_t)ts.nsec;
+}
+
+void* host_map(uint32_t bytes) {
+    int32_t addr = syscall6(SYS_MMAP2, 0, bytes, PROT_READ_WRITE, MAP_PRIVATE_ANON, (uint32_t)-1, 0);
+    if (addr < 0 && addr > -4096) return 0;
+    return (void*)addr;
+}
+
+uint8_t host_streq(const char* a, const char* b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+/* smp.h finds the current CPU through %gs, as in the kernel: point it at
+   a one-CPU table through a TLS descriptor */
+static cpu_t host_cpu;
+
+static void host_setup_gs(void) {
+    struct {
+        uint32_t entry_number;
+        uint32_t base_addr;
+        uint32_t limit;
+        uint32_t flags;          // seg_32bit, limit_in_pages, useable
+    } desc = { (uint32_t)-1, (uint32_t)&host_cpu, 0xFFFFF, 0x51 };
+    
+    host_cpu.self = &host_cpu;
+    host_cpu.index = 0;
+    host_cpu.online = 1;
+    if (syscall3(SYS_SET_THREAD_AREA, (uint32_t)&desc, 0, 0) < 0) {
+        host_write("hostbench: set_thread_area failed\n");
+        host_exit(1);
+    }
+    uint16_t selector = desc.entry_number * 8 + 3;
+    asm volatile ("movw %0, %%gs" : : "r"(selector));
+}
+
+/* 64-bit division for the reports, without libgcc: shift and subtract */
+static uint64_t udivmod64(uint64_t n, uint64_t d, uint64_t* rem) {
+    uint64_t q = 0, r = 0;
+    for (int i = 63; i >= 0; i--) {
+        r = (r << 1) | ((n >> i) & 1);
+        if (r >= d) {
+            r -= d;
+            q |= 1ull << i;
+        }
+    }
+    if (rem) *rem = r;
+    return q;
+}
+
+uint64_t __udivdi3(uint64_t n, uint64_t d) {
+    return udivmod64(n, d, 0);
+}
+
+uint64_t __umoddi3(uint64_t n, uint64_t d) {
+    uint64_t r;
+    udivmod64(n, d, &r);
+    return r;
+}
+
+uint64_t __udivmoddi4(uint64_t n, uint64_t d, uint64_t* rem) {
+    return udivmod64(n, d, rem);
+}
+
+/* The kernel's assembly uses PE-style leading underscores */
+asm (".globl context_switch\n"
+     "context_switch:\n"
+     "    jmp _context_switch\n");
+
+static void __attribute__((used, noreturn)) host_start(uint32_t* stack) {
+    int argc = stack[0];
+    char** argv = (char**)(stack + 1);
+    
+    host_setup_gs();
+    host_exit(host_main(argc, argv));
+}
+
+/* Entry: the kernel leaves argc at (%esp); realign for SSE spills */
+asm (".globl _start\n"
+     "_start:\n"
+     "    xorl %ebp, %ebp\n"
+     "    movl %esp, %eax\n"
+     "    andl $-16, %esp\n"
+     "    subl $12, %esp\n"
+     "    pushl %eax\n"
+     "    call host_start\n");
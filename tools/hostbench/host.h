@@ -0,0 +1,25 @@
+#ifndef HOST_H
+#define HOST_H
+
+#include <stdint.h>
+
+/* Freestanding i386 Linux runtime for the host benchmark
+   No libc: system calls go through int $0x80, so the harness runs on any
+   x86 Linux that can execute 32-bit binaries, multilib or not. */
+void host_write(const char* str);
+void host_write_bytes(const void* data, uint32_t len);
+void host_write_u32(uint32_t value);
+void host_write_u64(uint64_t value);
+void host_write_hex(uint32_t value);     /* 8 digits */
+void host_write_milli(uint64_t milli);   /* value / 1000 with three decimals */
+void __attribute__((noreturn)) host_exit(int status);
+
+uint64_t host_clock_ns(void);            /* CLOCK_MONOTONIC */
+void* host_map(uint32_t bytes);          /* Zeroed, page aligned; 0 on failure */
+
+uint8_t host_streq(const char* a, const char* b);
+
+/* Defined by the harness; argv[0] is the program */
+int host_main(int argc, char** argv);
+
+#endif
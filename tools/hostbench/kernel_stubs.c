@@ -0,0 +1,156 @@
+#include "host.h"
+#include "../../src/include/cpu.h"
+#include "../../src/include/pmm.h"
+#include "../../src/include/slab.h"
+#include "../../src/include/smp.h"
+#include "../../src/include/timer.h"
+#include "../../src/include/profile.h"
+#include "../../src/include/idt.h"
+
+/* Kernel services the benchmarked units link against, on one CPU and
+   a flat heap. Only what graphics.c, universe.c, gui.c and field.c
+   reach is here. */
+#define HOST_HEAP_BYTES  (96u << 20)
+
+static uint8_t* heap = 0;
+static uint32_t heap_used = 0;
+
+static void* heap_take(uint32_t size, uint32_t align) {
+    if (!heap) heap = host_map(HOST_HEAP_BYTES);
+    if (!heap) return 0;
+    
+    uint32_t start = (heap_used + align - 1) & ~(align - 1);
+    if (start + size > HOST_HEAP_BYTES) return 0;
+    heap_used = start + size;
+    return heap + start;
+}
+
+/* Pages are never returned: the harness sets up once and exits */
+uint32_t pmm_alloc_pages(uint32_t count) {
+    return (uint32_t)heap_take(count << PMM_PAGE_SHIFT, PMM_PAGE_SIZE);
+}
+
+uint32_t pmm_free_page_count(void) {
+    return (HOST_HEAP_BYTES - heap_used) >> PMM_PAGE_SHIFT;
+}
+
+void pmm_free_pages(uint32_t addr, uint32_t count) {
+    (void)addr;
+    (void)count;
+}
+
+void* kmalloc(uint32_t size) {
+    return heap_take(size, 16);
+}
+
+void kfree(void* ptr) {
+    (void)ptr;
+}
+
+/* Object caches keep a free list per cache, so field churn recycles */
+struct kmem_cache {
+    uint32_t size;
+    uint32_t align;
+    void (*ctor)(void* object);
+    void* free_list;
+};
+
+kmem_cache_t* kmem_cache_create(const char* name, uint32_t size, uint32_t align,
+                                void (*ctor)(void* object)) {
+    (void)name;
+    kmem_cache_t* cache = heap_take(sizeof(kmem_cache_t), 16);
+    if (!cache) return 0;
+    
+    cache->size = size < sizeof(void*) ? sizeof(void*) : size;
+    cache->align = align < 16 ? 16 : align;
+    cache->ctor = ctor;
+    cache->free_list = 0;
+    return cache;
+}
+
+void* kmem_cache_alloc(kmem_cache_t* cache) {
+    // Freed objects are back in their constructed state
+    void* object = cache->free_list;
+    if (object) {
+        cache->free_list = *(void**)object;
+        return object;
+    }
+    
+    object = heap_take(cache->size, cache->align);
+    if (object && cache->ctor) cache->ctor(object);
+    return object;
+}
+
+void kmem_cache_free(kmem_cache_t* cache, void* object) {
+    *(void**)object = cache->free_list;
+    cache->free_list = object;
+}
+
+/* One CPU: cross-CPU calls run in line */
+uint32_t smp_cpu_count(void) {
+    return 1;
+}
+
+void smp_wake(uint32_t index) {
+    (void)index;
+}
+
+uint8_t smp_call(void (*fn)(void* arg), void* arg) {
+    fn(arg);
+    return 1;
+}
+
+/* Halting skips ahead to the wake time, so idle waits cost nothing */
+static uint64_t clock_base = 0;
+static uint64_t clock_skipped = 0;
+
+uint64_t timer_now_ns(void) {
+    uint64_t now = host_clock_ns();
+    if (!clock_base) clock_base = now;
+    return now - clock_base + clock_skipped;
+}
+
+/* Measured once against the host clock, for trace timestamps */
+uint32_t timer_tsc_khz(void) {
+    static uint32_t khz = 0;
+    if (khz) return khz;
+    
+    uint64_t start_ns = host_clock_ns();
+    uint64_t start_tsc = rdtsc();
+    while (host_clock_ns() - start_ns < 10000000) {}
+    khz = (rdtsc() - start_tsc) * 1000000 / (host_clock_ns() - start_ns);
+    return khz;
+}
+
+uint64_t timer_ticks(void) {
+    return timer_now_ns() / (1000000000 / TIMER_HZ);
+}
+
+/* No frame pacing on the host: the HUD sees a steady target frame */
+const timer_frame_stats_t* timer_get_frame_stats(void) {
+    static timer_frame_stats_t stats = { 0, 0, 1000000000 / 60, 1000000000 / 60, 0, 0, 0, 0, 0 };
+    return &stats;
+}
+
+void timer_halt(uint64_t wake_ns) {
+    uint64_t now = timer_now_ns();
+    if (wake_ns > now) clock_skipped += wake_ns - now;
+}
+
+void terminal_writestring(const char* data) {
+    (void)data;
+}
+
+uint32_t interrupt_count(uint8_t vector) {
+    (void)vector;
+    return 0;
+}
+
+/* No RTC to sample from: the profiler stays off and empty */
+void profile_start(void) {}
+void profile_stop(void) {}
+uint8_t profile_running(void) { return 0; }
+void profile_reset(void) {}
+uint32_t profile_sample_count(void) { return 0; }
+uint32_t profile_top(profile_entry_t* out, uint32_t max) { (void)out; (void)max; return 0; }
+uint8_t profile_dump(void) { return 0; }
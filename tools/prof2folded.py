@@ -0,0 +1,46 @@
+import sys
+
+# Pull the profiler's folded stacks (F10 on the desktop, see
+# src/include/profile.h) out of a COM1 capture. The dump shares the line
+# with the binary trace stream; only the text between the markers is kept.
+#
+#   python tools/prof2folded.py capture.bin > kernel.folded
+#   flamegraph.pl kernel.folded > kernel.svg
+#
+# With several dumps in the capture the last one is used.
+
+BEGIN = b'# PXPROF BEGIN'
+END = b'# PXPROF END'
+
+def extract(data):
+    start = data.rfind(BEGIN)
+    if start < 0:
+        return None
+    stop = data.find(END, start)
+    if stop < 0:
+        return None
+
+    header, _, body = data[start:stop].partition(b'\n')
+    return header.decode('ascii', 'replace'), body.decode('ascii', 'replace')
+
+def main():
+    if len(sys.argv) not in (2, 3):
+        print('usage: prof2folded.py capture.bin [out.folded]')
+        sys.exit(1)
+
+    with open(sys.argv[1], 'rb') as f:
+        found = extract(f.read())
+    if found is None:
+        print('no complete ParadoxOS profile in %s' % sys.argv[1])
+        sys.exit(1)
+
+    header, body = found
+    if len(sys.argv) == 3:
+        with open(sys.argv[2], 'w') as out:
+            out.write(body)
+        print(header[2:])
+    else:
+        sys.stdout.write(body)
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,105 @@
+import sys
+import json
+import struct
+
+# Convert a ParadoxOS trace capture (COM1 output, see src/include/trace.h)
+# to Chrome trace / Perfetto JSON.
+#
+#   qemu-system-x86_64 -kernel paradox.bin -serial file:trace.bin ...
+#   python tools/trace2json.py trace.bin trace.json
+#
+# Then open trace.json in chrome://tracing or ui.perfetto.dev. Each CPU
+# shows as a thread; timestamps are microseconds from the first event.
+
+MAGIC = b'PXTR'
+VERSION = 1
+RECORD = struct.Struct('<BBHIQ')   # kind, cpu, point, arg, tsc
+
+def parse_header(data, pos):
+    # Returns (tsc_khz, names, next position), or None if it is cut short
+    if pos + 10 > len(data):
+        return None
+    version, count, khz = struct.unpack_from('<BBI', data, pos + 4)
+    if version != VERSION:
+        raise ValueError('unsupported trace version %d' % version)
+    pos += 10
+    names = []
+    for _ in range(count):
+        if pos >= len(data):
+            return None
+        length = data[pos]
+        names.append(data[pos + 1:pos + 1 + length].decode('ascii', 'replace'))
+        pos += 1 + length
+    return khz, names, pos
+
+def convert(data):
+    events = []
+    dropped = 0
+    tsc_base = None
+    khz = 0
+    names = None
+
+    # Skip to the first header: a capture may start mid-stream
+    pos = data.find(MAGIC)
+    while 0 <= pos < len(data):
+        if data[pos:pos + 4] == MAGIC:
+            header = parse_header(data, pos)
+            if header is None:
+                break
+            khz, names, pos = header
+            continue
+        if pos + RECORD.size > len(data):
+            break
+
+        kind, cpu, point, arg, tsc = RECORD.unpack_from(data, pos)
+        pos += RECORD.size
+        kind = chr(kind)
+
+        if kind == 'D':
+            dropped += arg
+            events.append({'name': 'dropped', 'ph': 'i', 's': 't', 'pid': 0, 'tid': cpu,
+                           'ts': events[-1]['ts'] if events else 0, 'args': {'events': arg}})
+            continue
+        if kind not in 'BECi' or point >= len(names):
+            # Lost sync: look for the next header
+            pos = data.find(MAGIC, pos)
+            continue
+
+        if tsc_base is None:
+            tsc_base = tsc
+        ts = (tsc - tsc_base) * 1000.0 / khz if khz else float(tsc - tsc_base)
+        name = names[point]
+        event = {'name': name, 'ph': kind, 'pid': 0, 'tid': cpu, 'ts': ts}
+        if kind == 'C':
+            event['args'] = {name: arg}
+        else:
+            event['args'] = {'arg': arg}
+            if kind == 'i':
+                event['s'] = 't'
+        events.append(event)
+
+    meta = [{'name': 'thread_name', 'ph': 'M', 'pid': 0, 'tid': cpu, 'args': {'name': 'CPU %d' % cpu}}
+            for cpu in sorted(set(e['tid'] for e in events))]
+    return {'traceEvents': meta + events, 'displayTimeUnit': 'ns',
+            'otherData': {'tsc_khz': khz, 'dropped_events': dropped}}
+
+def main():
+    if len(sys.argv) not in (2, 3):
+        print('usage: trace2json.py capture.bin [trace.json]')
+        sys.exit(1)
+
+    with open(sys.argv[1], 'rb') as f:
+        data = f.read()
+    if data.find(MAGIC) < 0:
+        print('no ParadoxOS trace header in %s' % sys.argv[1])
+        sys.exit(1)
+
+    trace = convert(data)
+    out = open(sys.argv[2], 'w') if len(sys.argv) == 3 else sys.stdout
+    json.dump(trace, out)
+    if out is not sys.stdout:
+        out.close()
+        print('%d events, %d dropped' % (len(trace['traceEvents']), trace['otherData']['dropped_events']))
+
+if __name__ == '__main__':
+    main()